@@ -3,11 +3,14 @@
 #include <iostream>
 #include <vector>
 
+#include "ConfigParser.h"
 #include "CountMin.h"
 #include "CountSketch.h"
 #include "HeavyHitterDetector.h"
 #include "Ideal.h"
 #include "PacketParser.h"
+#include "SyntheticTrace.h"
+#include "TraceCache.h"
 #include "UnivMon.h"
 
 using namespace std;
@@ -18,9 +21,14 @@ struct BenchmarkResult {
     double time_ms;
 };
 
-int main() {
+// 用法: baseline [config.ini]，配置中有 [synthetic] 时使用合成流量
+int main(int argc, char* argv[]) {
     // 配置参数
     const char* pcap_file = "../datasets/caida_600w.pcap";
+    SyntheticTraceConfig synthetic;
+    if (argc > 1 && !ConfigParser().parse_synthetic(argv[1], synthetic)) {
+        return 1;
+    }
 
     // 内存配置：64KB, 128KB, 256KB, 512KB, 1MB, 2MB, 4MB, 8MB
     vector<uint64_t> memory_sizes = {
@@ -41,7 +49,8 @@ int main() {
     vector<BenchmarkResult> results;
 
     cout << "DiSketch Baseline Benchmark" << endl;
-    cout << "Testing with: " << pcap_file << endl;
+    cout << "Testing with: "
+         << (synthetic.enabled ? "synthetic Zipf traffic" : pcap_file) << endl;
     cout << "Memory configurations: 64KB to 8MB" << endl;
 
     // 解析 PCAP 文件
@@ -51,16 +60,30 @@ int main() {
 
     PacketParser parser;
     vector<PacketRecord> packets;
+    bool cache_hit = false;
 
     try {
-        packets = parser.parse_pcap(pcap_file);
+        if (synthetic.enabled) {
+            auto start_gen = chrono::high_resolution_clock::now();
+            packets = generate_synthetic_trace(synthetic);
+            auto end_gen = chrono::high_resolution_clock::now();
+            double time_gen =
+                chrono::duration<double, milli>(end_gen - start_gen).count();
+            cout << "Generated " << packets.size() << " packets in "
+                 << time_gen << " ms" << endl;
+        } else {
+            // 重复运行时直接读取缓存，跳过 PCAP 解析
+            packets = TraceCache::load_or_parse(
+                pcap_file, TraceCache::default_path(pcap_file), parser,
+                &cache_hit);
+            cout << (cache_hit ? "Loaded " : "Parsed ") << packets.size()
+                 << " packets" << endl;
+        }
     } catch (const exception& e) {
         cerr << "Failed to parse PCAP file: " << e.what() << endl;
         return 1;
     }
 
-    cout << "Parsed " << packets.size() << " packets" << endl;
-
     // 使用 Ideal 建立 Ground Truth
     cout << "\n" << string(70, '=') << endl;
     cout << "Step 2: Building ground truth with Ideal..." << endl;
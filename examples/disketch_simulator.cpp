@@ -1,10 +1,20 @@
+#include <csignal>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <string>
 
+#include "CompressedTrace.h"
 #include "ConfigParser.h"
 #include "DiSketch.h"
+#include "FlowRecord.h"
+#include "LiveCapture.h"
 #include "PacketParser.h"
+#include "PacketSource.h"
+#include "PacketStore.h"
+#include "SyntheticTrace.h"
+#include "TraceCache.h"
+#include "TraceIndex.h"
 #include "cxxopts.hpp"
 
 namespace {
@@ -34,6 +44,164 @@ void emit_metrics_line(const std::string& method,
               << detector.tn << '\n';
 }
 
+/* 整个 trace 已在内存中时，按配置转换为压缩格式或列式存储后运行
+ * @param release_input 转换完成后释放原始记录
+ */
+DiSketchReport run_in_memory(DiSketch& manager,
+                             const DiSketchConfig& config,
+                             const PacketRecord* records,
+                             size_t count,
+                             bool quiet_mode,
+                             const std::function<void()>& release_input) {
+    if (config.compress_trace) {
+        CompressedTrace trace(records, count);
+        release_input();
+        if (!quiet_mode) {
+            std::cerr << "压缩 trace: " << trace.size() << " 个包, "
+                      << trace.flow_count() << " 条流, " << std::fixed
+                      << std::setprecision(2) << trace.bytes_per_packet()
+                      << " 字节/包" << std::endl;
+        }
+        CompressedPacketSource source(trace, config.parser.begin_ts);
+        return manager.run(source);
+    }
+    PacketStore store(records, count, config.epoch_duration_ns,
+                      config.parser.begin_ts);
+    release_input();
+    return manager.run(store);
+}
+
+// 以五元组或 IPv6 为流键时只走内存路径
+template <typename Key>
+DiSketchReport run_with_key(DiSketch& manager, const DiSketchConfig& config) {
+    BasicPacketParser<Key> packet_parser(config.parser);
+    typename BasicPacketParser<Key>::PacketVector packets =
+        parse_pcap_files(config.pcap_paths, packet_parser);
+    BasicPacketStore<Key> store(packets, config.epoch_duration_ns,
+                                config.parser.begin_ts);
+    typename BasicPacketParser<Key>::PacketVector().swap(packets);
+    return manager.run(store);
+}
+
+/* 把相对 trace 起点的 start_epoch/start_time_ns 换算为解析的时间范围
+ * 设置了 max_epochs 时范围终点也随之确定，之后的数据不再读取
+ */
+bool apply_start_offset(DiSketchConfig& config) {
+    uint64_t trace_start = 0;
+    if (!trace_start_time(config.pcap_paths, trace_start)) {
+        return false;
+    }
+    uint64_t begin = trace_start +
+                     config.start_epoch * config.epoch_duration_ns +
+                     config.start_time_ns;
+    config.parser.set_begin_ts(begin);
+    if (config.max_epochs > 0) {
+        config.parser.end_ts =
+            begin + config.max_epochs * config.epoch_duration_ns;
+    }
+    return true;
+}
+
+// 按配置创建流式输入：合成流量或 pcap 文件
+std::unique_ptr<PacketSource> make_input_source(const DiSketchConfig& config) {
+    if (config.synthetic.enabled) {
+        return std::unique_ptr<PacketSource>(
+            new SyntheticPacketSource(config.synthetic));
+    }
+    return make_pcap_source(config.pcap_paths, config.parser);
+}
+
+// 把全部输入读入内存：生成合成流量或逐个解析 pcap 文件
+PacketParser::PacketVector load_packets(const DiSketchConfig& config) {
+    if (config.synthetic.enabled) {
+        return generate_synthetic_trace(config.synthetic);
+    }
+    PacketParser packet_parser(config.parser);
+    return parse_pcap_files(config.pcap_paths, packet_parser);
+}
+
+/* 按包时间戳的 replay_speedup 倍速回放，报告处理落后于包时钟的程度
+ * 默认先把输入读入内存，只测量仿真本身；stream/pipeline 时解码也计入
+ */
+DiSketchReport run_replay(DiSketch& manager, const DiSketchConfig& config) {
+    PacketParser::PacketVector packets;
+    std::unique_ptr<PacketSource> input;
+    if (config.pipeline) {
+        input.reset(new PipelinedPacketSource(make_input_source(config)));
+    } else if (config.stream_input) {
+        input = make_input_source(config);
+    } else {
+        packets = load_packets(config);
+        input.reset(new VectorPacketSource(packets));
+    }
+
+    PacedPacketSource source(std::move(input), config.replay_speedup);
+    DiSketchReport report = manager.run(source);
+    ReplayStats stats = source.stats();
+
+    double speedup_limit = stats.estimated_sustainable_speedup();
+    std::cerr << std::fixed << std::setprecision(3) << "回放 x"
+              << config.replay_speedup << ": " << stats.packets << " 个包, "
+              << "包时钟 " << stats.trace_span_ns / 1e9 << " s, 处理 "
+              << stats.busy_ns() / 1e9 << " s, 空闲 " << stats.idle_ns / 1e9
+              << " s" << std::endl;
+    std::cerr << "落后: 最大 " << stats.max_lag_ns / 1e6 << " ms, 平均 "
+              << stats.mean_lag_ns / 1e6 << " ms, 结束时 "
+              << stats.final_lag_ns / 1e6 << " ms" << std::endl;
+    std::cerr << "可持续倍速估计: " << std::setprecision(2) << speedup_limit
+              << " (包时钟跨度 / 本次处理时长"
+              << (speedup_limit >= config.replay_speedup
+                      ? "，当前倍速估计跟得上)"
+                      : "，当前倍速估计跟不上)")
+              << std::endl;
+    return report;
+}
+
+// 读入全部流记录，以带权更新代替逐包处理
+DiSketchReport run_flow_records(DiSketch& manager,
+                                const DiSketchConfig& config,
+                                bool quiet_mode) {
+    std::vector<FlowRecord> records =
+        load_flow_records(config.flows.paths, config.flows.format);
+    if (!quiet_mode) {
+        uint64_t packets = 0;
+        for (const auto& record : records) {
+            packets += record.packets;
+        }
+        std::cerr << "流记录: " << records.size() << " 条, " << packets
+                  << " 个包" << std::endl;
+    }
+    return manager.run(records);
+}
+
+// 收到 SIGINT 时停止实时抓包，已抓到的包照常处理并输出结果
+LiveCaptureSource* active_capture = nullptr;
+
+void stop_capture(int) {
+    if (active_capture != nullptr) {
+        active_capture->stop();
+    }
+}
+
+DiSketchReport run_capture(DiSketch& manager, const DiSketchConfig& config) {
+    LiveCaptureSource source(config.capture);
+    active_capture = &source;
+    std::signal(SIGINT, stop_capture);
+    DiSketchReport report = manager.run(source);
+    source.stop();
+    std::signal(SIGINT, SIG_DFL);
+    active_capture = nullptr;
+
+    CaptureCounters counters = source.counters();
+    counters.late_drops = report.late_packets;
+    std::cerr << "抓包 " << config.capture.interface << ": 收到 "
+              << counters.received << " 帧, 交付 " << counters.delivered
+              << " 个包, 非 IPv4 " << counters.not_ipv4 << ", 队列丢包 "
+              << counters.ring_drops << ", 内核丢包 " << counters.kernel_drops
+              << ", 迟到丢弃 " << counters.late_drops << std::endl;
+    return report;
+}
+
 }  // namespace
 
 int main(int argc, char** argv) {
@@ -69,26 +237,73 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    PacketParser packet_parser;
-    PacketParser::PacketVector packets;
+    if (quiet_mode) {
+        config.enable_progress_bar = false;
+    }
+
+    if ((config.start_epoch > 0 || config.start_time_ns > 0) &&
+        !apply_start_offset(config)) {
+        std::cerr << "无法确定 trace 起始时间" << std::endl;
+        return 1;
+    }
+
+    DiSketch manager(config);
+    DiSketchReport report;
     try {
-        packets = packet_parser.parse_pcap(config.pcap_path);
+        TraceCache cache;
+        if (config.flows.enabled) {
+            report = run_flow_records(manager, config, quiet_mode);
+        } else if (config.flow_key == FlowKeyKind::FiveTuple) {
+            report = run_with_key<FiveTuple>(manager, config);
+        } else if (config.flow_key == FlowKeyKind::IPv6) {
+            report = run_with_key<IPv6TwoTuple>(manager, config);
+        } else if (config.capture.enabled) {
+            report = run_capture(manager, config);
+        } else if (config.replay_speedup > 0.0) {
+            report = run_replay(manager, config);
+        } else if (config.trace_cache &&
+                   cache.open(config.trace_cache_path,
+                              config.pcap_paths[0])) {
+            // 缓存命中，直接从映射中的记录建立内存表示
+            report = run_in_memory(manager, config, cache.data(), cache.size(),
+                                   quiet_mode, [&cache]() { cache.close(); });
+        } else if (config.pipeline) {
+            // 后台线程解码，主线程在 epoch 数据就绪后立即仿真
+            PipelinedPacketSource source(make_input_source(config));
+            report = manager.run(source);
+        } else if (config.stream_input) {
+            // 边读边算，不把整个 trace 读入内存
+            std::unique_ptr<PacketSource> source = make_input_source(config);
+            report = manager.run(*source);
+        } else {
+            PacketParser::PacketVector packets = load_packets(config);
+            if (config.trace_cache &&
+                !TraceCache::write(config.trace_cache_path,
+                                   config.pcap_paths[0], packets)) {
+                std::cerr << "写入 trace 缓存失败: " << config.trace_cache_path
+                          << std::endl;
+            }
+            report = run_in_memory(
+                manager, config, packets.data(), packets.size(), quiet_mode,
+                [&packets]() { PacketParser::PacketVector().swap(packets); });
+        }
     } catch (const std::exception& ex) {
-        std::cerr << "解析PCAP失败: " << ex.what() << std::endl;
+        std::cerr << "读取输入失败: " << ex.what() << std::endl;
         return 1;
     }
 
-    if (packets.empty()) {
+    if (report.epochs.empty()) {
         std::cerr << "没有可用数据包，无法继续" << std::endl;
         return 1;
     }
-
-    if (quiet_mode) {
-        config.enable_progress_bar = false;
+    if (!config.capture.enabled && report.late_packets > 0) {
+        std::cerr << "丢弃 " << report.late_packets
+                  << " 个早于所属 epoch 起点的包" << std::endl;
+    }
+    if (!quiet_mode && report.epoch_reruns > 0) {
+        std::cerr << "epoch 并行: subepoch 数预测失败, 重算 "
+                  << report.epoch_reruns << " 个 epoch" << std::endl;
     }
-
-    DiSketch manager(config);
-    DiSketchReport report = manager.run(packets);
 
         HeavyHitterDetector total_full_sketch;
         HeavyHitterDetector total_disketch;
@@ -1,14 +1,144 @@
 #include "PacketParser.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <stdexcept>
 
 constexpr int SHOW_NUM = 5;
 
+namespace {
+
+// 打开记录读取器，失败时抛出异常
+template <typename Reader>
+void open_reader(Reader& reader, const std::string& path) {
+    if (!reader.open()) {
+        throw std::runtime_error("Failed to open pcap file: " + path);
+    }
+}
+
+// 把全部记录读一遍，使两条路径都在热页缓存上计时，返回记录数
+template <typename Reader>
+size_t warm_page_cache(const std::string& path) {
+    Reader reader(path);
+    open_reader(reader, path);
+    PcapRecordView view;
+    size_t records = 0;
+    volatile uint8_t sink = 0;
+    while (reader.next_record(view)) {
+        sink = sink + view.data[view.incl_len - 1];
+        records += 1;
+    }
+    return records;
+}
+
+/* 只对解码循环计时，返回耗时（毫秒）
+ * 打开文件与时间戳排序不计入；输出按读取顺序，不排序
+ */
+template <typename Reader>
+double timed_decode(const PacketParser& parser,
+                    const std::string& path,
+                    size_t records,
+                    PacketParser::PacketVector& packets) {
+    Reader reader(path);
+    open_reader(reader, path);
+    packets.clear();
+    packets.reserve(records);
+    PcapRecordView view;
+    PacketRecord record;
+    auto start = std::chrono::steady_clock::now();
+    while (reader.next_record(view)) {
+        if (parser.decode_record(view, reader.link_type(), record)) {
+            packets.push_back(record);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+bool same_packets(const PacketParser::PacketVector& a,
+                  const PacketParser::PacketVector& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (!(a[i].flow == b[i].flow) || a[i].timestamp != b[i].timestamp) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* 对比快速解码与 PcapPlusPlus 完整解析两条路径
+ * 先预热页缓存，再交替两条路径的先后顺序各测 kRounds 次，取各自最快一次
+ */
+template <typename Reader>
+void run_decode_benchmark(const std::string& path) {
+    constexpr int kRounds = 3;
+    PacketParserConfig fast_config;
+    fast_config.fast_decode = true;
+    PacketParserConfig pcpp_config;
+    pcpp_config.fast_decode = false;
+    PacketParser fast_parser(fast_config);
+    PacketParser pcpp_parser(pcpp_config);
+
+    size_t records = warm_page_cache<Reader>(path);
+    PacketParser::PacketVector fast_packets;
+    PacketParser::PacketVector pcpp_packets;
+    double fast_ms = 0.0;
+    double pcpp_ms = 0.0;
+    for (int round = 0; round < kRounds; ++round) {
+        auto run_fast = [&]() {
+            double ms = timed_decode<Reader>(fast_parser, path, records,
+                                             fast_packets);
+            fast_ms = round == 0 ? ms : std::min(fast_ms, ms);
+        };
+        auto run_pcpp = [&]() {
+            double ms = timed_decode<Reader>(pcpp_parser, path, records,
+                                             pcpp_packets);
+            pcpp_ms = round == 0 ? ms : std::min(pcpp_ms, ms);
+        };
+        if (round % 2 == 0) {
+            run_fast();
+            run_pcpp();
+        } else {
+            run_pcpp();
+            run_fast();
+        }
+    }
+
+    auto mpps = [](size_t count, double ms) {
+        return ms > 0.0 ? count / (ms * 1000.0) : 0.0;
+    };
+
+    std::cout << "\nDecode benchmark (" << records << " records, best of "
+              << kRounds << ", decode loop only)" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::left << std::setw(14) << "path" << std::right
+              << std::setw(12) << "time(ms)" << std::setw(12) << "Mpps"
+              << std::endl;
+    std::cout << std::left << std::setw(14) << "fast" << std::right
+              << std::setw(12) << fast_ms << std::setw(12)
+              << mpps(records, fast_ms) << std::endl;
+    std::cout << std::left << std::setw(14) << "pcpp::Packet" << std::right
+              << std::setw(12) << pcpp_ms << std::setw(12)
+              << mpps(records, pcpp_ms) << std::endl;
+    if (fast_ms > 0.0) {
+        std::cout << "speedup: " << pcpp_ms / fast_ms << "x" << std::endl;
+    }
+    std::cout << "identical output: "
+              << (same_packets(fast_packets, pcpp_packets) ? "yes" : "no")
+              << std::endl;
+}
+
+}  // namespace
+
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: parse_pcap <pcap-file>" << std::endl;
+    bool bench = argc == 3 && std::strcmp(argv[2], "--bench") == 0;
+    if (argc != 2 && !bench) {
+        std::cerr << "Usage: parse_pcap <pcap-file> [--bench]" << std::endl;
         return 1;
     }
 
@@ -41,6 +171,14 @@ int main(int argc, char* argv[]) {
             std::cout << "... (" << (packets.size() - SHOW_NUM)
                       << " more packets)" << std::endl;
         }
+
+        if (bench) {
+            if (detect_trace_format(argv[1]) == TraceFormat::Pcap) {
+                run_decode_benchmark<MmapPcapReader>(argv[1]);
+            } else {
+                run_decode_benchmark<DirectPcapReader>(argv[1]);
+            }
+        }
     } catch (const std::exception& ex) {
         std::cerr << "Error: " << ex.what() << std::endl;
         return 1;
@@ -0,0 +1,148 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include "PacketParser.h"
+
+namespace {
+
+struct ReadResult {
+    size_t records = 0;  // 读到的记录数
+    size_t bytes = 0;    // 记录数据总字节数
+    double ms = 0.0;     // 耗时（毫秒）
+};
+
+// 尽量把文件从页缓存中逐出，让每种读取方式都从设备读
+void drop_page_cache(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+}
+
+template <typename Body>
+ReadResult timed(Body body) {
+    ReadResult result;
+    auto start = std::chrono::high_resolution_clock::now();
+    body(result);
+    auto end = std::chrono::high_resolution_clock::now();
+    result.ms = std::chrono::duration<double, std::milli>(end - start).count();
+    return result;
+}
+
+ReadResult read_ifstream(const std::string& path) {
+    return timed([&path](ReadResult& result) {
+        PcapReader reader(path);
+        if (!reader.open()) {
+            throw std::runtime_error("Failed to open pcap file: " + path);
+        }
+        pcpp::RawPacket raw_packet;
+        while (reader.get_next_packet(raw_packet)) {
+            result.records += 1;
+            result.bytes += raw_packet.getRawDataLen();
+        }
+        reader.close();
+    });
+}
+
+ReadResult read_mmap(const std::string& path) {
+    return timed([&path](ReadResult& result) {
+        MmapPcapReader reader(path);
+        if (!reader.open()) {
+            throw std::runtime_error("Failed to open pcap file: " + path);
+        }
+        PcapRecordView view;
+        while (reader.next_record(view)) {
+            // 读取首字节，确保映射页真正被访问
+            result.records += 1 + (view.data[0] & 0);
+            result.bytes += view.incl_len;
+        }
+        reader.close();
+    });
+}
+
+ReadResult read_direct(const std::string& path, bool& direct) {
+    return timed([&path, &direct](ReadResult& result) {
+        DirectPcapReader reader(path);
+        if (!reader.open()) {
+            throw std::runtime_error("Failed to open pcap file: " + path);
+        }
+        direct = reader.direct();
+        PcapRecordView view;
+        while (reader.next_record(view)) {
+            result.records += 1;
+            result.bytes += view.incl_len;
+        }
+        reader.close();
+    });
+}
+
+void print_row(const std::string& name, const ReadResult& result) {
+    double seconds = result.ms / 1000.0;
+    std::cout << std::left << std::setw(10) << name << std::right
+              << std::setw(12) << result.ms << std::setw(12)
+              << (seconds > 0.0 ? result.bytes / seconds / 1e6 : 0.0)
+              << std::setw(12)
+              << (seconds > 0.0 ? result.records / seconds / 1e6 : 0.0)
+              << std::setw(12) << result.records << std::endl;
+}
+
+}  // namespace
+
+// 对比 ifstream、mmap 与 O_DIRECT 预读三种读取方式在同一文件上的吞吐
+int main(int argc, char* argv[]) {
+    bool warm = argc == 3 && std::strcmp(argv[2], "--warm") == 0;
+    if (argc != 2 && !warm) {
+        std::cerr << "Usage: read_bench <pcap-file> [--warm]" << std::endl;
+        std::cerr << "  --warm  不清理页缓存，测量缓存命中时的吞吐"
+                  << std::endl;
+        return 1;
+    }
+    std::string path = argv[1];
+
+    try {
+        auto prepare = [&path, warm]() {
+            if (!warm) {
+                drop_page_cache(path);
+            }
+        };
+
+        prepare();
+        ReadResult ifstream_result = read_ifstream(path);
+        prepare();
+        ReadResult mmap_result = read_mmap(path);
+        prepare();
+        bool direct = false;
+        ReadResult direct_result = read_direct(path, direct);
+
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << std::left << std::setw(10) << "reader" << std::right
+                  << std::setw(12) << "time(ms)" << std::setw(12) << "MB/s"
+                  << std::setw(12) << "Mrec/s" << std::setw(12) << "records"
+                  << std::endl;
+        print_row("ifstream", ifstream_result);
+        print_row("mmap", mmap_result);
+        print_row(direct ? "direct" : "readahead", direct_result);
+        if (!direct) {
+            std::cout << "(文件系统不支持 O_DIRECT，预读线程使用普通读取)"
+                      << std::endl;
+        }
+        if (ifstream_result.records != mmap_result.records ||
+            mmap_result.records != direct_result.records) {
+            std::cerr << "记录数不一致" << std::endl;
+            return 1;
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
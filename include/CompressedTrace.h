@@ -0,0 +1,82 @@
+#ifndef DISKETCH_COMPRESSED_TRACE_H
+#define DISKETCH_COMPRESSED_TRACE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "PacketParser.h"
+#include "PacketSource.h"
+
+/* 压缩的内存 trace
+ * 二元组按出现频次编号后存入字典，包记录只保存字典下标；
+ * 时间戳保存与前一个包的差值，两者都用 varint 编码
+ * 数据按固定包数分块，每块记录起始时间戳和字节偏移，可独立解码
+ */
+class CompressedTrace {
+   public:
+    // 每块包含的包数
+    static constexpr size_t kBlockSize = 4096;
+
+    CompressedTrace() = default;
+    CompressedTrace(const PacketRecord* records, size_t count);
+    explicit CompressedTrace(const PacketParser::PacketVector& packets);
+
+    size_t size() const { return packet_count_; }
+    bool empty() const { return packet_count_ == 0; }
+    size_t block_count() const { return blocks_.size(); }
+    size_t flow_count() const { return dictionary_.size(); }
+    uint64_t first_ts() const { return first_ts_; }
+    uint64_t last_ts() const { return last_ts_; }
+
+    // 编码数据、块索引与字典占用的总字节数
+    size_t memory_bytes() const;
+    // 平均每包字节数
+    double bytes_per_packet() const;
+
+    /* 解码第 block 块
+     * @param out 至少能容纳 kBlockSize 条记录
+     * @return 本块包数
+     */
+    size_t decode_block(size_t block, PacketRecord* out) const;
+
+   private:
+    struct Block {
+        uint64_t first_ts;  // 块内第一个包的时间戳
+        size_t offset;      // 块在 bytes_ 中的起始偏移
+        uint32_t count;     // 块内包数
+    };
+
+    std::vector<uint8_t> bytes_;        // 逐包交替的 (时间差, 字典下标) varint 流
+    std::vector<Block> blocks_;         // 块索引
+    std::vector<TwoTuple> dictionary_;  // 字典下标到二元组
+    size_t packet_count_ = 0;
+    uint64_t first_ts_ = 0;
+    uint64_t last_ts_ = 0;
+
+    void encode(const PacketRecord* records, size_t count);
+};
+
+// 逐块解码 CompressedTrace 的数据包来源
+class CompressedPacketSource : public PacketSource {
+   public:
+    /**
+     * @param origin_ts 第一个 epoch 的起始时间戳，0 或晚于第一个包时从第一个包算起，
+     *                  与 PacketStore 相同
+     */
+    explicit CompressedPacketSource(const CompressedTrace& trace,
+                                    uint64_t origin_ts = 0);
+
+    size_t next_batch(const PacketRecord*& batch, size_t max_count) override;
+    bool time_bounds(uint64_t& first_ts, uint64_t& last_ts) const override;
+    bool start_time(uint64_t& start_ts) const override;
+
+   private:
+    const CompressedTrace& trace_;
+    uint64_t origin_ts_;
+    size_t next_block_ = 0;
+    size_t position_ = 0;  // 当前块中下一个未输出的包
+    size_t decoded_ = 0;   // 当前块已解码的包数
+    std::vector<PacketRecord> buffer_;
+};
+
+#endif  // DISKETCH_COMPRESSED_TRACE_H
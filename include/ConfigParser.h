@@ -19,12 +19,47 @@ class ConfigParser {
      */
     bool parse(const std::string& ini_path, DiSketchConfig& config);
 
+    /* 只解析 [synthetic] 合成流量配置，供不使用完整配置的程序调用
+     * @return 文件无法打开时返回 false；没有 [synthetic] 时 enabled 为 false
+     */
+    bool parse_synthetic(const std::string& ini_path,
+                         SyntheticTraceConfig& synthetic);
+
    private:
+    /// 读取 [synthetic] section
+    void read_synthetic(const CSimpleIniA& ini,
+                        SyntheticTraceConfig& synthetic) const;
+
+    /// 读取 [capture] section
+    void read_capture(const CSimpleIniA& ini, LiveCaptureConfig& capture) const;
+
+    /// 读取 [flows] section
+    void read_flows(const CSimpleIniA& ini, FlowRecordConfig& flows) const;
+
     /// 解析 Sketch 类型字符串
     SketchKind parse_sketch_kind(const std::string& value) const;
 
+    /// 解析流键类型字符串
+    FlowKeyKind parse_flow_key_kind(const std::string& value) const;
+
+    /// 把输入路径配置值展开为文件列表，支持逗号分隔和通配符
+    /// 通配符没有匹配或结果为空时返回 false
+    bool expand_input_paths(const std::string& value,
+                            std::vector<std::string>& paths) const;
+
     /// 解析布尔值字符串
     bool parse_bool(const std::string& value) const;
+
+    /// 读取非负的计数类配置，负数时警告并使用 default_value，
+    /// 超过 limit 时警告并截断为 limit
+    uint32_t read_count(const CSimpleIniA& ini,
+                        const char* section,
+                        const char* key,
+                        uint32_t default_value,
+                        uint32_t limit) const;
+
+    /// 线程数配置的上限：CPU 核心数的 4 倍，更多线程只会互相争抢
+    static uint32_t max_threads();
 };
 
 #endif  // CONFIG_PARSER_H
@@ -2,15 +2,45 @@
 #define DISKETCH_H
 
 #include "Epoch.h"
+#include "EpochEvaluator.h"
+#include "FlowRecord.h"
+#include "FragmentWorkers.h"
+#include "LiveCapture.h"
 #include "PacketParser.h"
+#include "PacketSampler.h"
+#include "PacketSource.h"
+#include "PacketStore.h"
+#include "SyntheticTrace.h"
 #include "Topology.h"
 #include "indicators.hpp"
 
 // DiSketch 整体配置
 struct DiSketchConfig {
     std::string pcap_path;               // 输入数据集路径（pcap 文件）
+    std::vector<std::string> pcap_paths;  // 展开列表和通配符后的全部输入文件
+    PacketParserConfig parser;           // pcap 解析配置
+    SyntheticTraceConfig synthetic;      // 合成流量配置，启用时不读取 pcap
+    LiveCaptureConfig capture;           // 实时抓包配置，启用时不读取 pcap
+    FlowRecordConfig flows;              // 流记录输入配置，启用时不读取 pcap
+    FlowKeyKind flow_key = FlowKeyKind::TwoTuple;  // 流键类型
+    SamplingConfig sampling;  // fragment 之前的入口包采样，不用于流记录输入
+    uint32_t fragment_threads = 0;  // fragment 工作线程数，0 或 1 为单线程
+    // epoch 评估的线程数，0 或 1 为单线程；多个线程同时查询 Full Sketch 与
+    // 各 fragment 的快照，要求这些 sketch 的种类都满足 sketch_query_is_read_only，
+    // 否则按单线程评估
+    uint32_t eval_threads = 0;
+    uint32_t eval_queue = 0;  // 后台评估最多积压的 epoch 数，0 为同步评估
+    uint32_t epoch_threads = 0;  // 内存 trace 上并行的 epoch 数，0 或 1 为串行
+    bool stream_input = false;  // 是否边读边算，不把整个 trace 读入内存
+    bool trace_cache = false;            // 是否使用已解析 trace 的二进制缓存
+    std::string trace_cache_path;        // 缓存文件路径
+    bool compress_trace = false;  // 内存中以压缩格式保存 trace
+    bool pipeline = false;  // 后台线程解码、主线程仿真，两者并行（隐含 stream_input）
+    double replay_speedup = 0.0;  // 按包间隔的倍速回放并测量处理落后，0 表示不回放
     TopologyConfig topology;             // 拓扑与 fragment 配置
     uint32_t max_epochs = 0;             // 最大 epoch 数，0 表示直到数据结束
+    uint64_t start_epoch = 0;    // 从 trace 起点之后第几个 epoch 开始仿真
+    uint64_t start_time_ns = 0;  // 在 start_epoch 之外再向后偏移的时长（纳秒）
     uint32_t full_sketch_depth = 8;      // Full Sketch 使用的 Sketch 深度或层数
     double heavy_hitter_ratio = 0.0001;  // 重点流筛选占比（按包数）
     uint64_t epoch_duration_ns = 1000000000ULL;  // 每个 epoch 大小（纳秒）
@@ -21,6 +51,8 @@ struct DiSketchConfig {
 // DiSketch 运行报告
 struct DiSketchReport {
     std::vector<EpochSummary> epochs;  // 按 epoch 汇总的统计结果
+    uint64_t epoch_reruns = 0;  // epoch 并行时 subepoch 数预测失败而重算的次数
+    uint64_t late_packets = 0;  // 时间戳早于当前 epoch 起点、被丢弃的包数
 };
 
 /// DiSketch 主管理器：协调多个 fragment、拓扑映射与聚合统计
@@ -28,9 +60,29 @@ class DiSketch {
    public:
     explicit DiSketch(DiSketchConfig config);
 
+    // 配置中的 sketch 能否被多个评估线程同时查询，见 eval_threads
+    static bool supports_eval_threads(const DiSketchConfig& config);
+
     // 执行完整的 DiSketch 流程，按输入数据的时间顺序迭代，返回按 epoch
     DiSketchReport run(const PacketParser::PacketVector& packets);
 
+    // 从 PacketSource 逐 epoch 拉取数据运行，内存占用与 trace 长度无关
+    DiSketchReport run(PacketSource& source);
+
+    /* 在列式存储上运行，按预建的 epoch/subepoch 下标区间处理，不再逐包比较时间戳
+     * store 的 epoch 索引时长必须与 epoch_ns 一致
+     * Key 为 TwoTuple、FiveTuple 或 IPv6TwoTuple，Sketch 与路径选择使用
+     * FlowKeyTraits<Key>::sketch_key 得到的 8 字节键
+     */
+    template <typename Key>
+    DiSketchReport run(const BasicPacketStore<Key>& store);
+
+    /* 在按 start_ns 排序的流记录上运行，每条记录的包数按时间均匀摊到
+     * 它覆盖的 epoch 与各 fragment 的 subepoch，每段只做一次带权更新
+     * epoch 从第一条记录的 start_ns 开始划分
+     */
+    DiSketchReport run(const std::vector<FlowRecord>& records);
+
    private:
     DiSketchConfig config_;  // 全局配置
     Topology topology_;      // 提供流到路径的映射
@@ -45,6 +97,111 @@ class DiSketch {
     // 更新进度条
     void update_progress(size_t completed_epochs);
 
+    // 汇总一个 epoch：对比 Full Sketch 与 DiSketch 对每个流的估计
+    EpochSummary summarize_epoch(
+        uint64_t epoch,
+        uint64_t epoch_packet_count,
+        Ideal& ideal,
+        Sketch* full_sketch,
+        const std::vector<FragmentEpochReport>& fragment_reports) const;
+
+    /* 按拓扑配置创建全部 fragment
+     * @param sampling_rate 进入 fragment 前的包采样率的倒数，写入子 epoch 记录
+     */
+    std::vector<Fragment> create_fragments(uint64_t epoch_duration,
+                                           uint32_t sampling_rate) const;
+
+    // fragment_threads 大于 1 时为 fragments 创建工作线程，否则返回空指针
+    std::unique_ptr<FragmentWorkerPool> create_workers(
+        std::vector<Fragment>& fragments) const;
+
+    // 开始新的 epoch：有工作线程时交给工作线程，否则直接调用
+    void begin_fragments(std::vector<Fragment>& fragments,
+                         FragmentWorkerPool* workers,
+                         uint64_t epoch,
+                         uint64_t epoch_start) const;
+
+    // 关闭当前 epoch 并按 fragment 下标收集报告
+    std::vector<FragmentEpochReport> close_fragments(
+        std::vector<Fragment>& fragments,
+        FragmentWorkerPool* workers) const;
+
+    // 生成 epoch 汇总的公共部分：ρ、包数、流数、subepoch 数量与重流阈值
+    EpochSummary begin_summary(
+        uint64_t epoch,
+        uint64_t epoch_packet_count,
+        uint64_t epoch_flow_count,
+        const std::vector<FragmentEpochReport>& fragment_reports) const;
+
+    // 评估单个流的估计值并累加到 summary 的检测器中
+    void evaluate_flow(const TwoTuple& flow,
+                       uint64_t packet_count,
+                       const PathSetting& path,
+                       Sketch* full_sketch,
+                       const std::vector<FragmentEpochReport>& fragment_reports,
+                       EpochSummary& summary) const;
+
+    // 在内存 trace 上处理 epoch 的可变状态，epoch 并行时每个线程一份
+    struct StoreLane;
+    // 一个 epoch 内各流的 (流编号, 真实包数)
+    using EpochCounts = std::vector<std::pair<uint32_t, uint64_t>>;
+
+    /* 在 lane 上摄入内存 trace 的第 epoch 个 epoch，返回各 fragment 的报告
+     * 本 epoch 的真实计数留在 lane 中，由 take_epoch_counts 取出
+     */
+    template <typename Key>
+    std::vector<FragmentEpochReport> ingest_store_epoch(
+        const BasicPacketStore<Key>& store,
+        uint64_t epoch,
+        StoreLane& lane) const;
+
+    // 取出 lane 中本 epoch 的真实计数并清零
+    std::shared_ptr<EpochCounts> take_epoch_counts(StoreLane& lane) const;
+
+    // 评估内存 trace 上的一个 epoch
+    EpochSummary evaluate_store_epoch(
+        uint64_t epoch,
+        uint64_t epoch_packet_count,
+        const EpochCounts& counts,
+        const TwoTuple* sketch_keys,
+        const std::vector<const PathSetting*>& flow_paths,
+        Sketch* full_sketch,
+        const std::vector<FragmentEpochReport>& fragment_reports) const;
+
+    /* epoch 并行：每轮在 lanes 上同时处理相邻的多个 epoch
+     * 各 epoch 都以上一轮确定的 subepoch 数开始，只有第一个是确定的；
+     * 之后按顺序验证，前一个 epoch 结束后 subepoch 数不变时预测成立，
+     * 否则丢弃其后的结果，从该 epoch 开始下一轮重算。结果与串行逐位一致
+     * 摄入阶段只写各 lane 自己的状态；验证之后才并行评估接受的 epoch
+     */
+    template <typename Key>
+    void run_epoch_parallel(const BasicPacketStore<Key>& store,
+                            uint64_t total_epochs,
+                            std::vector<std::unique_ptr<StoreLane>>& lanes,
+                            DiSketchReport& report);
+
+    /* 把本 epoch 的 summarize_epoch 交给 evaluator
+     * ideal 与 fragment_reports 移入评估任务；后台评估时任务接管 full_sketch，
+     * 并为下一个 epoch 换上新的实例
+     */
+    void submit_summary(
+        EpochEvaluator& evaluator,
+        uint64_t epoch,
+        uint64_t epoch_packet_count,
+        Ideal& ideal,
+        std::shared_ptr<Sketch>& full_sketch,
+        uint64_t full_sketch_memory,
+        std::vector<FragmentEpochReport>& fragment_reports) const;
+
+    /* 评估 flow_count 条流：按顺序切成连续的段，每个线程写入自己的部分汇总，
+     * 结束后按段的顺序合并，结果与串行评估逐位一致
+     * evaluate(i, part) 评估第 i 条流并累加到 part
+     */
+    template <typename Evaluate>
+    void evaluate_flows(size_t flow_count,
+                        EpochSummary& summary,
+                        const Evaluate& evaluate) const;
+
     // 创建一个未拆分的 Sketch
     std::unique_ptr<Sketch> create_full_sketch(uint64_t memory_bytes) const;
 
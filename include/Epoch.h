@@ -1,6 +1,8 @@
 #ifndef DISKETCH_EPOCH_H
 #define DISKETCH_EPOCH_H
 
+#include <algorithm>
+#include <climits>
 #include <memory>
 #include <vector>
 
@@ -11,9 +13,26 @@
 // 支持的 Sketch 类型
 enum class SketchKind { CountMin, CountSketch, UnivMon };
 
+// 该种类 sketch 的 query 是否只读取计数器，只读时才能被多个线程同时查询
+// Sketch::query 不是 const：Ideal 查询不存在的流会插入新项，UnivMon 不保证只读
+inline bool sketch_query_is_read_only(SketchKind kind) {
+    return kind == SketchKind::CountMin || kind == SketchKind::CountSketch;
+}
+
+// 给流增加 count 次计数；Sketch::update 的增量为 int，超出时分多次更新
+inline void update_weighted(Sketch& sketch,
+                            const TwoTuple& flow,
+                            uint64_t count) {
+    while (count > 0) {
+        int step = static_cast<int>(std::min<uint64_t>(count, INT_MAX));
+        sketch.update(flow, step);
+        count -= static_cast<uint64_t>(step);
+    }
+}
+
 // 流量估计对比指标
 struct FlowMetric {
-    TwoTuple flow;             // 二元组
+    TwoTuple flow;             // Sketch 使用的键，更宽的流键为折叠后的指纹
     uint64_t ideal = 0;        // 理想情况统计的真实包数
     uint64_t full_sketch = 0;  // 单一 Sketch 的估计值
     uint64_t disketch = 0;     // DiSketch 的估计值
@@ -25,6 +44,7 @@ struct SubepochRecord {
     uint64_t epoch_id = 0;         // 所属 epoch 号
     uint32_t subepoch_id = 0;      // 当前记录对应的子 epoch 编号
     uint32_t total_subepochs = 1;  // 当前 epoch 内的总子 epoch 数量
+    uint32_t sampling_rate = 1;    // 进入 fragment 前的包采样率的倒数
     uint64_t hash_seed = 0;        // 子 epoch 使用的随机哈希种子
     uint64_t packet_count = 0;     // 子 epoch 内观察到的数据包数量
     double rho_estimate = 0.0;     // 该子 epoch 估计得到的 ρ 值
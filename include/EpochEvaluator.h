@@ -0,0 +1,60 @@
+#ifndef DISKETCH_EPOCH_EVALUATOR_H
+#define DISKETCH_EPOCH_EVALUATOR_H
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "Epoch.h"
+#include "SpscRing.h"
+
+/* 按提交顺序执行 epoch 评估
+ * depth 大于 0 时在后台线程评估，与后续 epoch 的摄入重叠；
+ * 最多 depth 个 epoch 已提交但未评估完，再提交时阻塞，评估所持有的
+ * 真实计数、Full Sketch 与 fragment 报告的内存随之封顶
+ * depth 为 0 时在调用线程直接评估
+ */
+class EpochEvaluator {
+   public:
+    // 评估一个 epoch，任务自行持有所需的全部状态
+    using Job = std::function<EpochSummary()>;
+
+    // depth 的上限，每个积压的 epoch 都持有一整份评估状态
+    static constexpr size_t kMaxDepth = 64;
+
+    // @param depth 超过 kMaxDepth 时按 kMaxDepth 处理
+    explicit EpochEvaluator(size_t depth);
+    ~EpochEvaluator();
+
+    EpochEvaluator(const EpochEvaluator&) = delete;
+    EpochEvaluator& operator=(const EpochEvaluator&) = delete;
+
+    // 是否在后台线程评估
+    bool async() const { return depth_ > 0; }
+
+    // 提交一个 epoch 的评估；后台评估已出错时直接抛出该异常
+    void submit(Job job);
+
+    // 等待全部评估完成，按提交顺序返回汇总；评估中的异常在这里重新抛出
+    std::vector<EpochSummary> finish();
+
+   private:
+    size_t depth_;
+    SpscRing<Job> ring_;                 // 已提交待评估的任务，空任务表示结束
+    std::atomic<size_t> pending_{0};     // 已提交但未评估完的 epoch 数
+    SpscWaiter drained_;                 // 提交方等待 pending_ 低于 depth
+    std::atomic<bool> failed_{false};    // error_ 已写入
+    std::atomic<bool> cancelled_{false};  // 未调用 finish 就析构，跳过剩余任务
+    std::exception_ptr error_;           // 后台评估的第一个异常
+    std::vector<EpochSummary> summaries_;  // 按提交顺序的评估结果
+    std::thread thread_;
+
+    // 向队列写入一个任务，队列满时等待
+    void push(Job job);
+    // 后台线程主循环
+    void work();
+};
+
+#endif  // DISKETCH_EPOCH_EVALUATOR_H
@@ -0,0 +1,114 @@
+#ifndef DISKETCH_FLOW_KEY_H
+#define DISKETCH_FLOW_KEY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "TwoTuple.h"
+
+// 流键类型
+enum class FlowKeyKind {
+    TwoTuple,   // IPv4 源/目的地址，8 字节
+    FiveTuple,  // IPv4 五元组，16 字节
+    IPv6,       // IPv6 源/目的地址（IPv4 映射为 ::ffff:a.b.c.d），32 字节
+};
+
+// IPv4 五元组，端口为主机字节序，TCP/UDP 以外的协议和分片的端口为 0
+struct FiveTuple {
+    uint32_t src_ip = 0;  // 与 TwoTuple 相同，保留网络字节序
+    uint32_t dst_ip = 0;
+    uint16_t src_port = 0;
+    uint16_t dst_port = 0;
+    uint8_t protocol = 0;
+    uint8_t padding[3] = {0, 0, 0};  // 显式补齐，保证逐字节比较和哈希
+
+    bool operator==(const FiveTuple& other) const {
+        return std::memcmp(this, &other, sizeof(FiveTuple)) == 0;
+    }
+};
+
+// IPv6 二元组
+struct IPv6TwoTuple {
+    uint8_t src_ip[16] = {};
+    uint8_t dst_ip[16] = {};
+
+    bool operator==(const IPv6TwoTuple& other) const {
+        return std::memcmp(this, &other, sizeof(IPv6TwoTuple)) == 0;
+    }
+};
+
+static_assert(sizeof(FiveTuple) == 16, "FiveTuple must stay unpadded");
+static_assert(sizeof(IPv6TwoTuple) == 32, "IPv6TwoTuple must stay unpadded");
+
+// 64 位整数混合函数（murmur3 finalizer）
+inline uint64_t mix_flow_bits(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// 把 words 个 64 位字折叠为一个 64 位指纹
+inline uint64_t fold_flow_words(const void* key, size_t words) {
+    uint64_t h = 0;
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t word;
+        std::memcpy(&word, static_cast<const uint8_t*>(key) + i * 8,
+                    sizeof(word));
+        h = mix_flow_bits(h ^ word);
+    }
+    return h;
+}
+
+/* 流键特性，引擎按键类型在编译期选择哈希与折叠方式
+ * Hash: 哈希表使用的哈希函数
+ * sketch_key: SketchLib 只接受 TwoTuple，更宽的键折叠为 64 位指纹，
+ *             每个流只在建立字典时折叠一次，热路径上始终是 8 字节的键
+ */
+template <typename Key>
+struct FlowKeyTraits;
+
+template <>
+struct FlowKeyTraits<TwoTuple> {
+    using Hash = TwoTupleHash;
+    static constexpr FlowKeyKind kind = FlowKeyKind::TwoTuple;
+
+    static const TwoTuple& sketch_key(const TwoTuple& flow) { return flow; }
+};
+
+template <>
+struct FlowKeyTraits<FiveTuple> {
+    struct Hash {
+        size_t operator()(const FiveTuple& flow) const {
+            return static_cast<size_t>(fold_flow_words(&flow, 2));
+        }
+    };
+    static constexpr FlowKeyKind kind = FlowKeyKind::FiveTuple;
+
+    static TwoTuple sketch_key(const FiveTuple& flow) {
+        uint64_t h = fold_flow_words(&flow, 2);
+        return TwoTuple(static_cast<uint32_t>(h >> 32),
+                        static_cast<uint32_t>(h));
+    }
+};
+
+template <>
+struct FlowKeyTraits<IPv6TwoTuple> {
+    struct Hash {
+        size_t operator()(const IPv6TwoTuple& flow) const {
+            return static_cast<size_t>(fold_flow_words(&flow, 4));
+        }
+    };
+    static constexpr FlowKeyKind kind = FlowKeyKind::IPv6;
+
+    static TwoTuple sketch_key(const IPv6TwoTuple& flow) {
+        uint64_t h = fold_flow_words(&flow, 4);
+        return TwoTuple(static_cast<uint32_t>(h >> 32),
+                        static_cast<uint32_t>(h));
+    }
+};
+
+#endif  // DISKETCH_FLOW_KEY_H
@@ -0,0 +1,83 @@
+#ifndef DISKETCH_FLOW_RECORD_H
+#define DISKETCH_FLOW_RECORD_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TwoTuple.h"
+
+/* 预聚合的流记录（NetFlow/IPFIX 风格）
+ * 一条记录代表同一条流在 [start_ns, end_ns] 内的 packets 个包，
+ * 仿真时按时间均匀摊到覆盖的 epoch 与 subepoch，以带权更新代替逐包更新
+ */
+struct FlowRecord {
+    TwoTuple flow;
+    uint64_t start_ns = 0;  // 第一个包的时间戳（纳秒）
+    uint64_t end_ns = 0;    // 最后一个包的时间戳（纳秒），不早于 start_ns
+    uint64_t packets = 0;   // 包数
+    uint64_t bytes = 0;     // 字节数，只做记录，仿真按包数计数
+
+    /* 时间戳落在 [begin_ns, end_ns) 内的包数
+     * 包在记录的时间范围内等间隔分布，第一个包位于 start_ns；
+     * 相邻区间的结果首尾相接，任意划分下各段之和都等于 packets
+     */
+    uint64_t packets_between(uint64_t begin_ns, uint64_t end_ns) const;
+};
+
+// 流记录文件格式
+enum class FlowRecordFormat {
+    Auto,    // 有二进制文件头时按二进制读取，否则按 CSV
+    Csv,     // src_ip,dst_ip,start_ns,end_ns,packets[,bytes]
+    Binary,  // FlowRecordFileHeader 之后紧跟定长记录
+};
+
+// 流记录输入配置
+struct FlowRecordConfig {
+    bool enabled = false;              // 以流记录代替 pcap 输入
+    std::string path;                  // 配置中的原始路径
+    std::vector<std::string> paths;    // 展开列表和通配符后的全部文件
+    FlowRecordFormat format = FlowRecordFormat::Auto;  // 文件格式
+};
+
+// 二进制流记录文件头
+struct FlowRecordFileHeader {
+    char magic[8];          // 固定为 "DSKFLOWS"
+    uint32_t version;       // 格式版本
+    uint32_t record_size;   // 单条记录字节数
+    uint64_t record_count;  // 记录条数
+};
+
+// 二进制文件中的单条记录，小端序，IP 地址为主机序整数
+struct FlowRecordFileEntry {
+    uint32_t src_ip;
+    uint32_t dst_ip;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint64_t packets;
+    uint64_t bytes;
+};
+
+static_assert(sizeof(FlowRecordFileEntry) == 40,
+              "FlowRecordFileEntry must stay packed");
+
+// 根据文件头判断格式
+FlowRecordFormat detect_flow_record_format(const std::string& path);
+
+/* 读取单个流记录文件，保持文件中的顺序
+ * CSV 的 IP 地址可以是点分十进制或整数，空行与 # 开头的行被跳过，
+ * 第一个有效行不是数字开头时视为表头；格式错误时抛出 std::runtime_error
+ */
+std::vector<FlowRecord> read_flow_records(
+    const std::string& path,
+    FlowRecordFormat format = FlowRecordFormat::Auto);
+
+// 读取全部文件并按 start_ns 稳定排序，跳过包数为 0 的记录
+std::vector<FlowRecord> load_flow_records(const std::vector<std::string>& paths,
+                                          FlowRecordFormat format);
+
+// 以二进制格式写出，先写临时文件再 rename
+bool write_flow_records(const std::string& path,
+                        const std::vector<FlowRecord>& records);
+
+#endif  // DISKETCH_FLOW_RECORD_H
@@ -5,6 +5,7 @@
 #include "CountSketch.h"
 #include "Epoch.h"
 #include "HashFunction.h"
+#include "ParallelRun.h"
 #include "TwoTuple.h"
 #include "UnivMon.h"
 
@@ -20,6 +21,8 @@ struct FragmentSetting {
     uint32_t max_subepoch = 8;  // 允许自动扩展的 subepoch 上限
     uint32_t initial_subepoch = 1;  // 初始的 subepoch 数量
     bool boost_single_hop = false;  // 单跳流是否在多个 subepoch 中采样
+    uint32_t sampling_rate = 1;  // 入口包采样率的倒数，时间聚合时乘回
+    uint32_t ingest_shards = 1;  // sketch 更新的分片线程数，仅线性 sketch 可大于 1
     SketchKind kind = SketchKind::CountSketch;  // fragment 使用的 Sketch 种类
 };
 
@@ -48,12 +51,46 @@ class Fragment {
                         uint64_t packet_time_ns,
                         bool single_hop);
 
+    /** 推进到指定 subepoch，之后由 process_in_subepoch 直接处理该段内的包
+     * 调用方需保证 subepoch_index 单调不减
+     */
+    void advance_to_subepoch(uint32_t subepoch_index);
+
+    // 在当前 subepoch 内处理单个数据包，不再根据时间戳定位 subepoch
+    void process_in_subepoch(const TwoTuple& flow, bool single_hop);
+
+    /** 按流编号处理，分配到的 subepoch 在每个 epoch 内只计算一次
+     * 需先调用 reserve_flow_ids，flow_id 小于其参数
+     */
+    void process_in_subepoch(uint32_t flow_id,
+                             const TwoTuple& flow,
+                             bool single_hop);
+
+    /** 在当前 subepoch 内计入同一条流的 count 个包，一次带权更新代替逐包更新
+     * 用于预聚合的流记录，采样规则与逐包处理相同
+     */
+    void process_weighted_in_subepoch(const TwoTuple& flow,
+                                      uint64_t count,
+                                      bool single_hop);
+
+    // 为 [0, flow_count) 范围的流编号分配缓存
+    void reserve_flow_ids(size_t flow_count);
+
     // 在 epoch 结束时输出 fragment 的 subepoch 汇总，并重置为下一轮做准备
     FragmentEpochReport close_epoch();
 
     // 返回 fragment 的静态配置
     const FragmentSetting& config() const { return setting_; }
 
+    // 当前 epoch 的 subepoch 数量与时长
+    uint32_t subepoch_count() const { return subepoch_count_; }
+    uint64_t subepoch_duration() const { return subepoch_duration_; }
+
+    // 指定下一个 epoch 的 subepoch 数，epoch 并行时按预测值开始 epoch
+    void set_subepoch_count(uint32_t count) {
+        subepoch_count_ = std::max(kMinSubepoch, count);
+    }
+
     // 判断某个流是否应该被指定 subepoch 采样
     static bool should_track(const TwoTuple& flow,
                              uint64_t hash_seed,
@@ -62,6 +99,21 @@ class Fragment {
                              bool single_hop,
                              bool boost_single_hop);
 
+    // 该种类的 sketch 能否分片写入：需要 SketchLib 提供按计数器合并的 merge
+    static bool supports_ingest_shards(SketchKind kind);
+
+    // 流在给定 epoch 哈希种子下被分配到的 subepoch
+    static uint32_t assigned_subepoch(const TwoTuple& flow,
+                                      uint64_t hash_seed,
+                                      uint32_t total_subepochs);
+
+    // 已知分配结果时判断指定 subepoch 是否采样该流，规则与 should_track 相同
+    static bool subepoch_matches(uint32_t assigned,
+                                 uint32_t subepoch_id,
+                                 uint32_t total_subepochs,
+                                 bool single_hop,
+                                 bool boost_single_hop);
+
     // 时间聚合: 从 FragmentEpochReport 的多个 subepoch 中恢复流量估计
     static uint64_t temporal_aggregation(const TwoTuple& flow,
                                          const FragmentEpochReport& report,
@@ -69,6 +121,12 @@ class Fragment {
                                          bool boost_single_hop);
 
    private:
+    // 分片写入时缓存的一次更新
+    struct PendingUpdate {
+        TwoTuple flow;
+        uint64_t count;
+    };
+
     int index_;                       // fragment 下标
     FragmentSetting setting_;         // fragment 配置
     uint64_t epoch_duration_ns_;      // epoch 长度
@@ -81,6 +139,15 @@ class Fragment {
     uint64_t subepoch_duration_ = 0;  // subepoch 时长
     double current_rho_ = 0.0;        // 当前 subepoch 的 ρ 值
     std::vector<SubepochRecord> emitted_records_;  // 已输出的 subepoch 记录
+    // 按流编号缓存的分配结果，高 32 位为 epoch_id + 1，低 32 位为 subepoch
+    std::vector<uint64_t> assignment_cache_;
+    uint32_t shard_count_ = 1;             // 实际使用的分片数
+    std::vector<PendingUpdate> pending_;   // 当前 subepoch 尚未写入的更新
+    std::vector<uint64_t> rho_deltas_;     // 分片重放得到的逐次 ρ 增量
+    // 分片的部分 sketch，前缀求和后作为各段的重放起点
+    std::vector<std::unique_ptr<Sketch>> shard_sketches_;
+    // 分片写入的常驻线程，各个 subepoch 复用，分片数为 1 时为空
+    std::unique_ptr<ParallelRunner> shard_runner_;
 
     std::unique_ptr<HashFunction> hash_func_;
     std::unique_ptr<Sketch> sketch_;
@@ -92,8 +159,28 @@ class Fragment {
     // 将内部状态推进到指定子 epoch
     void flush_until(uint32_t target_subepoch);
 
-    // 更新 sketch 并增量更新 current_rho_
-    void update_sketch_and_rho(const TwoTuple& flow);
+    // 按 subepoch_index 的采样规则决定是否计入当前 sketch
+    void track_packet(const TwoTuple& flow,
+                      uint32_t subepoch_index,
+                      bool single_hop);
+    /* 给流增加 count 次计数，并增量更新 current_rho_
+     * 分片写入时先缓存，攒够一批或 subepoch 结束时由 apply_pending 写入
+     */
+    void update_sketch_and_rho(const TwoTuple& flow, uint64_t count);
+    // 更新 sketch，返回本次更新对 ρ 的增量（CountMin 为估计值之差，
+    // CountSketch 为估计值平方之差）
+    uint64_t update_and_measure(Sketch& sketch,
+                                const TwoTuple& flow,
+                                uint64_t count) const;
+    // 按更新顺序把一次增量累加到 current_rho_
+    void accumulate_rho(uint64_t delta);
+    // Sketch 每行的计数器数，无法获取时为 0
+    uint64_t sketch_width() const;
+    /* 分片并行写入缓存的更新：前 K-1 段各自写入清零的部分 sketch，
+     * 前缀求和得到每段开始时的完整状态，再并行重放各段求出逐次 ρ 增量，
+     * 最后按原顺序累加；sketch 与 ρ 都与逐个更新的结果逐位一致
+     */
+    void apply_pending();
     // 根据 ρ 动态调整 subepoch 数
     void adjust_subepoch(double avg_rho);
 };
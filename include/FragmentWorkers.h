@@ -0,0 +1,100 @@
+#ifndef DISKETCH_FRAGMENT_WORKERS_H
+#define DISKETCH_FRAGMENT_WORKERS_H
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "SpscRing.h"
+#include "Topology.h"
+
+// 交给 fragment 工作线程的单个包
+struct FragmentTask {
+    TwoTuple flow;
+    uint64_t timestamp_ns;
+    const PathSetting* path;
+    bool single_hop;
+};
+
+// 分发线程与工作线程之间传递的一批包或一条控制命令
+struct FragmentBatch {
+    enum class Kind { Packets, BeginEpoch, CloseEpoch, Stop };
+
+    Kind kind = Kind::Packets;
+    uint64_t epoch_id = 0;        // BeginEpoch 使用
+    uint64_t epoch_start_ns = 0;  // BeginEpoch 使用
+    std::vector<FragmentTask> tasks;
+};
+
+/* 按 fragment 划分的并行执行：fragment f 归第 f % worker_count 个工作线程所有，
+ * 调用线程作为分发者，把包按路径分批写入相关工作线程的 SPSC 环形队列
+ * 每个 fragment 只被一个线程访问，收到包的顺序与串行执行相同，结果逐位一致
+ * epoch 结束时所有工作线程关闭各自的 fragment 后在屏障处汇合
+ * 存续期间 fragments 只能通过本类访问
+ */
+class FragmentWorkerPool {
+   public:
+    /* @param fragments 全部 fragment，下标与 PathSetting::node_indices 一致
+     * @param paths 拓扑中的全部路径，dispatch 只接受其中的元素
+     * @param worker_count 工作线程数，不超过 fragment 数
+     */
+    FragmentWorkerPool(std::vector<Fragment>& fragments,
+                       const std::vector<PathSetting>& paths,
+                       size_t worker_count);
+    ~FragmentWorkerPool();
+
+    FragmentWorkerPool(const FragmentWorkerPool&) = delete;
+    FragmentWorkerPool& operator=(const FragmentWorkerPool&) = delete;
+
+    // 通知全部工作线程开始新的 epoch
+    void begin_epoch(uint64_t epoch_id, uint64_t epoch_start_ns);
+
+    // 把包交给路径上各 fragment 所属的工作线程
+    void dispatch(const TwoTuple& flow,
+                  uint64_t timestamp_ns,
+                  const PathSetting& path);
+
+    /* 关闭当前 epoch，等待全部工作线程完成后按 fragment 下标返回报告
+     * 工作线程中的异常在这里重新抛出
+     */
+    std::vector<FragmentEpochReport> close_epoch();
+
+    size_t worker_count() const { return workers_.size(); }
+
+   private:
+    struct Worker {
+        explicit Worker(size_t ring_batches) : ring(ring_batches) {}
+
+        SpscRing<FragmentBatch> ring;
+        FragmentBatch* pending = nullptr;  // 分发线程正在填充的批
+        std::vector<int> fragments;        // 该线程负责的 fragment 下标
+        std::exception_ptr error;          // 工作线程中的第一个异常
+        std::thread thread;
+    };
+
+    std::vector<Fragment>& fragments_;
+    const PathSetting* paths_ = nullptr;
+    std::vector<size_t> owners_;          // 每个 fragment 所属的工作线程
+    std::vector<uint64_t> path_workers_;  // 每条路径涉及的工作线程位图
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<FragmentEpochReport> reports_;
+    std::atomic<size_t> closed_{0};  // 已关闭当前 epoch 的工作线程数
+    SpscWaiter barrier_;             // 分发线程在 close_epoch 中等待 closed_
+
+    // 分发线程：取得可写槽位，队列已满时等待
+    FragmentBatch* acquire(Worker& worker);
+    // 分发线程：发布正在填充的包批
+    void flush(Worker& worker);
+    // 分发线程：向全部工作线程发送控制命令
+    void broadcast(FragmentBatch::Kind kind,
+                   uint64_t epoch_id,
+                   uint64_t epoch_start_ns);
+    // 工作线程：处理一批包或一条命令
+    void run_batch(size_t index, const FragmentBatch& batch);
+    // 工作线程主循环
+    void work(size_t index);
+};
+
+#endif  // DISKETCH_FRAGMENT_WORKERS_H
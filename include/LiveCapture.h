@@ -0,0 +1,100 @@
+#ifndef DISKETCH_LIVE_CAPTURE_H
+#define DISKETCH_LIVE_CAPTURE_H
+
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "PacketParser.h"
+#include "PacketSource.h"
+#include "SpscRing.h"
+
+// 实时抓包配置
+struct LiveCaptureConfig {
+    bool enabled = false;              // 从网卡实时抓包代替 pcap 输入
+    std::string interface = "lo";      // 网卡名称
+    uint64_t duration_ns = 0;          // 抓包时长，0 表示直到 max_epochs 或被中断
+    size_t ring_batches = 256;         // 环形队列中的批数
+    size_t batch_size = 1024;          // 每批最多包数
+    uint64_t flush_ns = 1000000;       // 未满的批最多等待多久就交给消费者
+    size_t socket_buffer = 16 << 20;   // 套接字接收缓冲区字节数
+    bool promiscuous = false;          // 是否开启混杂模式
+};
+
+// 抓包计数
+struct CaptureCounters {
+    uint64_t received = 0;      // 从套接字读到的帧数
+    uint64_t delivered = 0;     // 成功解码并交给消费者的包数
+    uint64_t not_ipv4 = 0;      // 不含 IPv4 头部或无法解码而跳过的帧数
+    uint64_t ring_drops = 0;    // 环形队列已满而丢弃的包数
+    uint64_t kernel_drops = 0;  // 内核因接收缓冲区溢出丢弃的包数
+    uint64_t late_drops = 0;    // 交付后早于当前 epoch 起点、被仿真丢弃的包数
+};
+
+/* 基于 AF_PACKET 原始套接字的实时数据包来源
+ * 抓包线程读取帧、解码二元组，按批写入 SPSC 环形队列，由 DiSketch 在主线程消费；
+ * 队列已满时抓包线程直接丢包并计数，从不等待消费者
+ * 时间戳为收包时的系统时钟，epoch 从抓包开始时刻算起，没有流量时也按墙钟结束
+ * 抓包线程发布水位：早于水位收到的包都已入队；wait_for_data 等到水位越过
+ * deadline 才超时，并让抓包线程提前交出含 deadline 之前的包的未满批
+ * 回环网卡上每个包会以发送和接收方向各出现一次，只保留接收方向
+ * 需要 CAP_NET_RAW 权限
+ */
+class LiveCaptureSource : public PacketSource {
+   public:
+    explicit LiveCaptureSource(const LiveCaptureConfig& config);
+    ~LiveCaptureSource() override;
+
+    LiveCaptureSource(const LiveCaptureSource&) = delete;
+    LiveCaptureSource& operator=(const LiveCaptureSource&) = delete;
+
+    // 抓包线程中的异常会在这里重新抛出
+    size_t next_batch(const PacketRecord*& batch, size_t max_count) override;
+    bool wait_for_data(uint64_t deadline_ts) override;
+    // 抓包开始的时刻
+    bool start_time(uint64_t& start_ts) const override;
+
+    // 停止抓包，已入队的包仍会交付；只写原子变量，可在信号处理函数中调用
+    void stop() { stop_.store(true, std::memory_order_relaxed); }
+
+    CaptureCounters counters() const;
+
+   private:
+    LiveCaptureConfig config_;
+    int fd_ = -1;
+    pcpp::LinkLayerType link_type_ = pcpp::LINKTYPE_ETHERNET;
+    bool loopback_ = false;
+    uint64_t start_ns_ = 0;
+
+    SpscRing<std::vector<PacketRecord>> ring_;
+    std::atomic<bool> producer_done_{false};
+    std::atomic<bool> stop_{false};
+    // 时间戳早于该值的包都已发布或计入丢包，只由抓包线程推进
+    std::atomic<uint64_t> watermark_{0};
+    // 消费者等待的截止时间已到，未满的批中有早于它的包时立即发布
+    std::atomic<uint64_t> flush_at_{std::numeric_limits<uint64_t>::max()};
+    std::exception_ptr error_;
+    std::thread producer_;
+
+    // 抓包线程写、其他线程读的计数
+    std::atomic<uint64_t> received_{0};
+    std::atomic<uint64_t> delivered_{0};
+    std::atomic<uint64_t> not_ipv4_{0};
+    std::atomic<uint64_t> ring_drops_{0};
+    std::atomic<uint64_t> kernel_drops_{0};
+
+    // 消费者当前持有的批
+    std::vector<PacketRecord>* current_ = nullptr;
+    size_t position_ = 0;
+
+    // 打开并绑定套接字，识别链路类型
+    void open_socket();
+    void capture();
+    // 累加内核丢包计数，读取后内核侧计数清零
+    void poll_kernel_drops();
+};
+
+#endif  // DISKETCH_LIVE_CAPTURE_H
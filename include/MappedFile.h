@@ -0,0 +1,40 @@
+#ifndef DISKETCH_MAPPED_FILE_H
+#define DISKETCH_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 只读内存映射文件，析构时自动解除映射
+class MappedFile {
+   public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /* 以只读方式映射整个文件
+     * @param path 文件路径
+     * @return 映射成功返回 true，文件不存在或为空时返回 false
+     */
+    bool open(const std::string& path);
+
+    // 解除映射并关闭文件
+    void close();
+
+    // 提示内核丢弃 [0, length) 范围内已不再访问的页
+    void release_prefix(size_t length) const;
+
+    bool is_open() const { return data_ != nullptr; }
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+   private:
+    const uint8_t* data_ = nullptr;  // 映射起始地址
+    size_t size_ = 0;                // 映射长度（字节）
+};
+
+#endif  // DISKETCH_MAPPED_FILE_H
@@ -5,25 +5,44 @@
 #include <chrono>
 #include <cstdint>
 #include <cstring>
+#include <exception>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "FlowKey.h"
 #include "IPv4Layer.h"
+#include "MappedFile.h"
 #include "Packet.h"
+#include "ReadAheadFile.h"
 #include "TwoTuple.h"
 
-struct PacketRecord {
-    TwoTuple flow;
+// 数据包记录，Key 为流键类型
+template <typename Key>
+struct BasicPacketRecord {
+    Key flow;
     std::chrono::nanoseconds timestamp;
 };
 
+// 默认的 IPv4 二元组记录，16 字节
+using PacketRecord = BasicPacketRecord<TwoTuple>;
+
 uint32_t ip_string_to_uint32(const std::string& ip_str);
 
 std::string uint32_to_ip_string(uint32_t ip);
 
+/* 按时间戳稳定排序
+ * @param descents 解码时统计的逆序次数（后一个包早于前一个包），为 0 时不做任何操作
+ * 逆序较少时只对迟到的包排序并与主序列归并，逆序较多时改用基数排序
+ */
+template <typename Key>
+void sort_by_timestamp(std::vector<BasicPacketRecord<Key>>& packets,
+                       size_t descents);
+
 // 根据文件大小估计 reserve 空间
 size_t estimate_packet_count(const std::string& file_path);
 
@@ -38,6 +57,55 @@ inline uint32_t swap_bytes32(uint32_t val) {
            ((val & 0x00FF0000) >> 8) | ((val & 0xFF000000) >> 24);
 }
 
+// trace 文件格式，由文件开头的 magic 判断
+enum class TraceFormat {
+    Pcap,     // 经典 pcap
+    PcapNg,   // pcapng
+    Gzip,     // gzip 压缩
+    Zstd,     // zstd 压缩
+    Xz,       // xz 压缩
+    Unknown,  // 无法识别或无法读取
+};
+
+TraceFormat detect_trace_format(const std::string& file_path);
+
+// 压缩格式对应的解压程序，非压缩格式返回 nullptr
+const char* trace_decompressor(TraceFormat format);
+
+// 快速路径的解码结果
+enum class DecodeStatus {
+    Ok,           // 成功提取 IPv4 二元组
+    NotIPv4,      // 确定不含 IPv4 头部，直接丢弃
+    Unsupported,  // 无法识别的链路类型或封装，需回退到 PcapPlusPlus
+};
+
+/* 不构造 pcpp::Packet，直接跳到 IPv4 头部提取二元组
+ * 支持 Ethernet（含 802.1Q/QinQ）、Raw IP、Linux SLL/SLL2
+ * 判定规则与 PcapPlusPlus 一致，结果可与 getLayerOfType<IPv4Layer>() 互换
+ */
+DecodeStatus decode_ipv4_flow(const uint8_t* data,
+                              size_t length,
+                              pcpp::LinkLayerType link_type,
+                              TwoTuple& flow);
+
+/* 按流键类型解码，链路层与隧道的处理规则同 decode_ipv4_flow
+ * FiveTuple 额外读取 TCP/UDP 端口；IPv6TwoTuple 同时接受 IPv4 和 IPv6
+ */
+inline DecodeStatus decode_flow(const uint8_t* data,
+                                size_t length,
+                                pcpp::LinkLayerType link_type,
+                                TwoTuple& flow) {
+    return decode_ipv4_flow(data, length, link_type, flow);
+}
+DecodeStatus decode_flow(const uint8_t* data,
+                         size_t length,
+                         pcpp::LinkLayerType link_type,
+                         FiveTuple& flow);
+DecodeStatus decode_flow(const uint8_t* data,
+                         size_t length,
+                         pcpp::LinkLayerType link_type,
+                         IPv6TwoTuple& flow);
+
 class PcapReader {
    public:
     explicit PcapReader(const std::string& filename);
@@ -54,11 +122,195 @@ class PcapReader {
     pcpp::LinkLayerType link_type_;
 };
 
-class PacketParser {
+// 直接指向映射内存的 pcap 记录视图，生命周期与 reader 相同
+struct PcapRecordView {
+    const uint8_t* data = nullptr;  // 数据包内容（不含记录头）
+    uint32_t incl_len = 0;          // 文件中保存的长度
+    uint32_t orig_len = 0;          // 原始报文长度
+    uint64_t timestamp_ns = 0;      // 时间戳（纳秒）
+};
+
+// 基于 mmap 的 pcap 读取器，原地遍历记录头，不做逐包内存分配
+class MmapPcapReader {
+   public:
+    explicit MmapPcapReader(const std::string& filename);
+
+    bool open();
+    // 读取下一条记录，返回的视图在 close() 之前有效
+    bool next_record(PcapRecordView& record);
+    void close();
+
+    // 只读取起始偏移落在 [begin, end) 内的记录
+    void set_range(size_t begin, size_t end);
+    /* 借用本 reader 的映射，只读取 [begin, end) 内记录的视图
+     * 视图不拥有映射，须在本 reader close() 之前用完；多个视图可在不同线程遍历
+     */
+    MmapPcapReader view(size_t begin, size_t end) const;
+    // 从 from 开始查找第一个能连续通过校验的记录头偏移，找不到时返回文件大小
+    size_t find_record_boundary(size_t from) const;
+
+    pcpp::LinkLayerType link_type() const { return link_type_; }
+    size_t offset() const { return offset_; }
+    size_t file_size() const { return size_; }
+
+    // 归还已读过部分的映射页，流式读取长 trace 时限制常驻内存
+    void release_consumed();
+
+   private:
+    std::string filename_;
+    MappedFile file_;                // 视图不拥有映射，file_ 保持关闭
+    const uint8_t* data_ = nullptr;  // 映射起始地址
+    size_t size_ = 0;                // 映射长度（字节）
+    size_t offset_;  // 下一条记录头的偏移
+    size_t end_;     // 读取范围的结束偏移
+    size_t released_ = 0;  // 已归还的映射前缀长度
+    uint32_t snaplen_;
+    bool is_big_endian_;
+    bool has_nano_precision_;
+    pcpp::LinkLayerType link_type_;
+
+    // 读取 offset 处的记录头并转换为主机字节序
+    void load_header(size_t offset, uint32_t fields[4]) const;
+};
+
+/* 基于预读线程的 pcap 读取器，数据以大块对齐读入，适合 NVMe 等高吞吐设备
+ * 同时支持 pcapng，以及经 gzip/zstd/xz 压缩的 pcap 与 pcapng，
+ * 压缩文件由外部解压程序在独立进程中解压，只能顺序读取
+ */
+class DirectPcapReader {
+   public:
+    explicit DirectPcapReader(const std::string& filename);
+
+    bool open();
+    // 读取下一条记录，返回的视图在下一次调用前有效
+    bool next_record(PcapRecordView& record);
+    void close();
+
+    // 最近一条记录的链路类型，pcapng 的不同接口可以不同
+    pcpp::LinkLayerType link_type() const { return link_type_; }
+    // 是否以 O_DIRECT 绕过页缓存
+    bool direct() const { return file_.direct(); }
+
+   private:
+    // pcapng 接口描述
+    struct PcapNgInterface {
+        pcpp::LinkLayerType link_type = pcpp::LINKTYPE_ETHERNET;
+        uint8_t ts_resolution = 6;  // if_tsresol，默认微秒
+        int64_t ts_offset_sec = 0;  // if_tsoffset
+    };
+
+    std::string filename_;
+    ReadAheadFile file_;
+    const uint8_t* cursor_ = nullptr;  // 当前块中的读取位置
+    size_t available_ = 0;             // 当前块剩余字节数
+    std::vector<uint8_t> straddle_;    // 拼接跨块的记录
+    bool is_big_endian_;
+    bool has_nano_precision_;
+    pcpp::LinkLayerType link_type_;
+    bool pcapng_ = false;
+    std::vector<PcapNgInterface> interfaces_;  // 当前 section 的接口
+
+    /* 取出接下来 length 个连续字节，跨块时拼接到 straddle_
+     * @return 数据指针；返回 nullptr 且 taken 为已读字节数表示文件结束
+     */
+    const uint8_t* take(size_t length, size_t& taken);
+    // 跳过 length 个字节，不做拷贝
+    void skip(size_t length);
+
+    /* 读取 section header block 中块长度之后的部分，确定字节序
+     * @param raw_length 未做字节序转换的块长度
+     */
+    bool read_section_header(uint32_t raw_length);
+    // 解析 interface description block 的内容
+    void add_interface(const uint8_t* body, size_t length);
+    bool next_pcapng_record(PcapRecordView& record);
+    uint32_t load32(const uint8_t* p) const;
+};
+
+// pcap 读取方式
+enum class PcapReadMode {
+    Stream,  // std::ifstream 逐包读取
+    Mmap,    // 内存映射，零拷贝
+    Direct,  // O_DIRECT 大块预读
+};
+
+// PacketParser 配置
+struct PacketParserConfig {
+    PcapReadMode read_mode = PcapReadMode::Mmap;  // pcap 读取方式
+    bool fast_decode = true;  // 是否启用绕过 pcpp::Packet 的快速解码
+    uint32_t parse_threads = 1;  // Mmap 模式的解析线程数，0 表示使用全部核心
+    size_t reorder_window = 65536;  // 流式读取时用于纠正乱序的缓冲包数
+    // 只保留时间戳在 [begin_ts, end_ts) 内的包（纳秒）
+    // 起点只在 has_begin_ts 时生效，可以为 0；end_ts 为 0 表示终点不限
+    // Mmap 模式下借助 TraceIndex 直接跳到对应的字节区间
+    bool has_begin_ts = false;
+    uint64_t begin_ts = 0;
+    uint64_t end_ts = 0;
+
+    // 设置时间起点，epoch 从该时刻开始划分
+    void set_begin_ts(uint64_t ts) {
+        has_begin_ts = true;
+        begin_ts = ts;
+    }
+    bool has_time_window() const { return has_begin_ts || end_ts > 0; }
+    bool in_time_window(uint64_t ts) const {
+        return (!has_begin_ts || ts >= begin_ts) &&
+               (end_ts == 0 || ts < end_ts);
+    }
+};
+
+/* pcap 解析器，Key 为输出记录的流键类型
+ * 实现位于 PacketParser.cpp，对 TwoTuple、FiveTuple、IPv6TwoTuple 显式实例化
+ */
+template <typename Key>
+class BasicPacketParser {
    public:
-    using PacketVector = std::vector<PacketRecord>;
+    using Record = BasicPacketRecord<Key>;
+    using PacketVector = std::vector<Record>;
+
+    explicit BasicPacketParser(
+        PacketParserConfig config = PacketParserConfig());
 
     PacketVector parse_pcap(const std::string& file_path) const;
+
+    // 解码单条 pcap 记录，不含所需网络层时返回 false
+    bool decode_record(const PcapRecordView& view,
+                       pcpp::LinkLayerType link_type,
+                       Record& record) const;
+
+    const PacketParserConfig& config() const { return config_; }
+
+   private:
+    PacketParserConfig config_;
+
+    // 以下解析函数同时统计时间戳逆序次数 descents，供排序阶段使用
+    void parse_stream(const std::string& file_path,
+                      PacketVector& packets,
+                      size_t& descents) const;
+    void parse_mmap(const std::string& file_path,
+                    PacketVector& packets,
+                    size_t& descents) const;
+    // 把 [range_begin, range_end) 分块并行解析，边界校验失败时返回 false 交由串行路径处理
+    bool parse_mmap_parallel(const std::string& file_path,
+                             const MmapPcapReader& reader,
+                             size_t range_begin,
+                             size_t range_end,
+                             size_t threads,
+                             PacketVector& packets,
+                             size_t& descents) const;
+    void parse_direct(const std::string& file_path,
+                      PacketVector& packets,
+                      size_t& descents) const;
+    // 解码 reader 当前范围内的全部记录，Reader 为 MmapPcapReader 或 DirectPcapReader
+    template <typename Reader>
+    void decode_records(Reader& reader,
+                        PacketVector& packets,
+                        size_t& descents) const;
+
+    // 从原始报文中提取流键，不含所需网络层时返回 false
+    bool extract_flow(pcpp::RawPacket& raw_packet, Key& flow) const;
 };
 
+using PacketParser = BasicPacketParser<TwoTuple>;
+
 #endif
@@ -0,0 +1,74 @@
+#ifndef DISKETCH_PACKET_SAMPLER_H
+#define DISKETCH_PACKET_SAMPLER_H
+
+#include <cstdint>
+#include <limits>
+
+#include "FlowKey.h"
+
+// 包采样方式
+enum class SamplingMode {
+    None,           // 不采样
+    Deterministic,  // 每 rate 个包固定取一个
+    Hash,           // 按流键与时间戳的哈希以 1/rate 的概率取包，结果可复现
+};
+
+// sFlow 风格的入口包采样配置，只作用于 fragment，真实计数与 Full Sketch 不采样
+struct SamplingConfig {
+    SamplingMode mode = SamplingMode::None;
+    uint32_t rate = 1;   // 采样率的倒数 N，即平均每 N 个包取一个
+    uint64_t seed = 0;   // 哈希采样的种子
+
+    bool enabled() const { return mode != SamplingMode::None && rate > 1; }
+};
+
+/* 在包进入 fragment 之前做采样，被选中的包由路径上所有 fragment 共同处理，
+ * 各 fragment 看到同一个样本；估计值在时间聚合中乘以 rate 还原
+ */
+class PacketSampler {
+   public:
+    explicit PacketSampler(const SamplingConfig& config)
+        : config_(config),
+          threshold_(std::numeric_limits<uint64_t>::max() /
+                     (config.rate > 0 ? config.rate : 1)) {}
+
+    // 是否保留该包
+    bool sample(const TwoTuple& flow, uint64_t timestamp_ns) {
+        switch (config_.mode) {
+            case SamplingMode::Deterministic:
+                if (++counter_ < config_.rate) {
+                    return false;
+                }
+                counter_ = 0;
+                return true;
+            case SamplingMode::Hash: {
+                uint64_t key = (static_cast<uint64_t>(flow.src_ip) << 32) |
+                               flow.dst_ip;
+                uint64_t h = mix_flow_bits(key ^ config_.seed);
+                return mix_flow_bits(h ^ timestamp_ns) < threshold_;
+            }
+            default:
+                return true;
+        }
+    }
+
+    /* 把状态设为从起点起已看过 packets 个包之后的状态，与之前处理过哪些包无关
+     * 确定性采样的计数只取决于包序号，哈希采样没有状态；
+     * 各 epoch 据此从自己的第一个包独立开始
+     */
+    void seek(uint64_t packets) {
+        if (config_.mode == SamplingMode::Deterministic && config_.rate > 0) {
+            counter_ = static_cast<uint32_t>(packets % config_.rate);
+        }
+    }
+
+    // 估计值的还原倍数
+    uint32_t scale() const { return config_.enabled() ? config_.rate : 1; }
+
+   private:
+    SamplingConfig config_;
+    uint64_t threshold_;    // 哈希值低于该阈值时保留
+    uint32_t counter_ = 0;  // 上次保留之后经过的包数
+};
+
+#endif  // DISKETCH_PACKET_SAMPLER_H
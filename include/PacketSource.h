@@ -0,0 +1,297 @@
+#ifndef DISKETCH_PACKET_SOURCE_H
+#define DISKETCH_PACKET_SOURCE_H
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <thread>
+
+#include "PacketParser.h"
+#include "SpscRing.h"
+
+// 拉取式数据包来源，按时间顺序分批输出 BasicPacketRecord<Key>
+template <typename Key>
+class BasicPacketSource {
+   public:
+    using Record = BasicPacketRecord<Key>;
+
+    virtual ~BasicPacketSource() = default;
+
+    /* 读取下一批数据包
+     * @param batch 输出本批数据的只读指针，在下一次调用前有效
+     * @param max_count 本批最多读取的包数
+     * @return 本批包数，返回 0 表示数据耗尽
+     */
+    virtual size_t next_batch(const Record*& batch, size_t max_count) = 0;
+
+    // 数据的起止时间戳（纳秒），事先未知时返回 false
+    virtual bool time_bounds(uint64_t& first_ts, uint64_t& last_ts) const {
+        (void)first_ts;
+        (void)last_ts;
+        return false;
+    }
+
+    /* 等待数据直到系统时钟到达 deadline_ts（纳秒），供实时来源按墙钟结束 epoch
+     * 有数据可读或来源已结束时返回 true；超时返回 false，之后交付的包时间戳都不早于
+     * deadline_ts。离线来源的数据总是可读
+     */
+    virtual bool wait_for_data(uint64_t deadline_ts) {
+        (void)deadline_ts;
+        return true;
+    }
+
+    // 数据的时钟起点（纳秒），epoch 从这里算起：实时来源为抓包开始时刻，
+    // 截取时间范围的来源为范围起点；返回 false 时从第一个包算起
+    virtual bool start_time(uint64_t& start_ts) const {
+        (void)start_ts;
+        return false;
+    }
+};
+
+// 以下具体来源均输出 IPv4 二元组记录
+using PacketSource = BasicPacketSource<TwoTuple>;
+
+// 适配已解析完成的记录数组，不拷贝数据
+template <typename Key>
+class BasicVectorPacketSource : public BasicPacketSource<Key> {
+   public:
+    using Record = BasicPacketRecord<Key>;
+
+    explicit BasicVectorPacketSource(const std::vector<Record>& packets);
+
+    size_t next_batch(const Record*& batch, size_t max_count) override;
+    bool time_bounds(uint64_t& first_ts, uint64_t& last_ts) const override;
+
+   private:
+    const std::vector<Record>& packets_;
+    size_t position_ = 0;
+};
+
+using VectorPacketSource = BasicVectorPacketSource<TwoTuple>;
+
+// 边读边解码的 pcap 来源，内存占用与 trace 长度无关
+// 用 reorder_window 大小的小顶堆纠正局部乱序，超出窗口的迟到包按到达顺序输出
+// 时间戳相同的包保持读入顺序
+// pcapng、压缩 trace 和 Direct 读取方式使用 DirectPcapReader，其余使用 mmap
+class PcapPacketSource : public PacketSource {
+   public:
+    PcapPacketSource(const std::string& file_path,
+                     PacketParserConfig config = PacketParserConfig());
+
+    size_t next_batch(const PacketRecord*& batch, size_t max_count) override;
+    // 设置了 begin_ts 时 epoch 从 begin_ts 算起
+    bool start_time(uint64_t& start_ts) const override;
+
+   private:
+    // 乱序窗口中的包，sequence 为读入顺序
+    struct Pending {
+        PacketRecord record;
+        uint64_t sequence;
+    };
+
+    // 时间戳相同时先读入的先输出，与内存路径的稳定排序一致
+    struct LaterFirst {
+        bool operator()(const Pending& a, const Pending& b) const {
+            if (a.record.timestamp != b.record.timestamp) {
+                return a.record.timestamp > b.record.timestamp;
+            }
+            return a.sequence > b.sequence;
+        }
+    };
+
+    PacketParser parser_;
+    std::unique_ptr<MmapPcapReader> mmap_reader_;
+    std::unique_ptr<DirectPcapReader> direct_reader_;
+    std::vector<PacketRecord> buffer_;
+    bool reader_done_ = false;
+    std::priority_queue<Pending, std::vector<Pending>, LaterFirst> reorder_;
+    uint64_t next_sequence_ = 0;  // 下一个读入的包的序号
+
+    // 从 reader 读取并解码，直到乱序窗口填满或读完
+    template <typename Reader>
+    void fill_window(Reader& reader, size_t window);
+};
+
+// 由回调逐包生成数据，回调返回 false 表示结束
+class GeneratorPacketSource : public PacketSource {
+   public:
+    using Generator = std::function<bool(PacketRecord&)>;
+
+    explicit GeneratorPacketSource(Generator generator);
+
+    size_t next_batch(const PacketRecord*& batch, size_t max_count) override;
+
+   private:
+    Generator generator_;
+    bool finished_ = false;
+    std::vector<PacketRecord> buffer_;
+};
+
+/* 多个按时间有序的来源做 k 路归并，输出一个整体有序的数据流
+ * 每个来源只缓存当前一批，内存占用与来源数量成正比；时间戳相同时按来源顺序输出
+ */
+template <typename Key>
+class BasicMergedPacketSource : public BasicPacketSource<Key> {
+   public:
+    using Record = BasicPacketRecord<Key>;
+
+    explicit BasicMergedPacketSource(
+        std::vector<std::unique_ptr<BasicPacketSource<Key>>> sources);
+
+    size_t next_batch(const Record*& batch, size_t max_count) override;
+    // 全部来源的时间范围都已知时返回整体范围
+    bool time_bounds(uint64_t& first_ts, uint64_t& last_ts) const override;
+    // 全部来源的时钟起点都已知时返回最早的起点
+    bool start_time(uint64_t& start_ts) const override;
+
+   private:
+    struct Cursor {
+        const Record* batch = nullptr;
+        size_t size = 0;
+        size_t position = 0;
+    };
+    struct Head {
+        uint64_t timestamp;
+        size_t source;
+    };
+    struct LaterFirst {
+        bool operator()(const Head& a, const Head& b) const {
+            return a.timestamp != b.timestamp ? a.timestamp > b.timestamp
+                                              : a.source > b.source;
+        }
+    };
+
+    std::vector<std::unique_ptr<BasicPacketSource<Key>>> sources_;
+    std::vector<Cursor> cursors_;
+    std::priority_queue<Head, std::vector<Head>, LaterFirst> heads_;
+    std::vector<Record> buffer_;
+    bool started_ = false;
+
+    // 让 source 的游标指向下一条记录，来源耗尽时返回 false
+    bool advance(size_t source);
+};
+
+using MergedPacketSource = BasicMergedPacketSource<TwoTuple>;
+
+/* 为一组 pcap 文件创建流式来源，多个文件时做 k 路归并
+ * @param paths 输入文件，至少一个
+ */
+std::unique_ptr<PacketSource> make_pcap_source(
+    const std::vector<std::string>& paths,
+    const PacketParserConfig& config);
+
+/* 逐个完整解析 pcap 文件，再把各自有序的结果归并为一个有序序列
+ * 不对合并后的整体重新排序
+ */
+template <typename Key>
+typename BasicPacketParser<Key>::PacketVector parse_pcap_files(
+    const std::vector<std::string>& paths,
+    const BasicPacketParser<Key>& parser);
+
+/* 在后台线程中拉取另一个 PacketSource，通过 SPSC 环形队列按批交给消费者
+ * 解码与仿真并行进行，总耗时接近两者中较慢的一方
+ */
+class PipelinedPacketSource : public PacketSource {
+   public:
+    /* @param inner 被包装的来源，之后只由后台线程访问
+     * @param depth 环形队列中的批数
+     * @param batch_size 每批最多包数
+     */
+    explicit PipelinedPacketSource(std::unique_ptr<PacketSource> inner,
+                                   size_t depth = 64,
+                                   size_t batch_size = 4096);
+    ~PipelinedPacketSource() override;
+
+    PipelinedPacketSource(const PipelinedPacketSource&) = delete;
+    PipelinedPacketSource& operator=(const PipelinedPacketSource&) = delete;
+
+    // 后台线程中的异常会在这里重新抛出
+    size_t next_batch(const PacketRecord*& batch, size_t max_count) override;
+    bool time_bounds(uint64_t& first_ts, uint64_t& last_ts) const override;
+    bool start_time(uint64_t& start_ts) const override;
+
+   private:
+    std::unique_ptr<PacketSource> inner_;
+    size_t batch_size_;
+    SpscRing<std::vector<PacketRecord>> ring_;
+    std::atomic<bool> producer_done_{false};
+    std::atomic<bool> stop_{false};
+    std::exception_ptr error_;
+    std::thread producer_;
+
+    // 消费者当前持有的批
+    std::vector<PacketRecord>* current_ = nullptr;
+    size_t position_ = 0;
+
+    void produce();
+};
+
+// 按包时间戳节奏回放的统计结果，时间均为墙钟纳秒
+struct ReplayStats {
+    uint64_t packets = 0;        // 已交付的包数
+    uint64_t trace_span_ns = 0;  // 已交付包的时间戳跨度（包时钟）
+    uint64_t elapsed_ns = 0;     // 从第一个包交付到统计时的墙钟时长
+    uint64_t idle_ns = 0;        // 等待下一个包到期的时长
+    uint64_t max_lag_ns = 0;     // 处理落后于包时钟的最大值
+    double mean_lag_ns = 0.0;    // 按包数加权的平均落后
+    uint64_t final_lag_ns = 0;   // 统计时落后于最后一个包到期时刻的时长
+
+    // 处理消耗的墙钟时长
+    uint64_t busy_ns() const {
+        return elapsed_ns > idle_ns ? elapsed_ns - idle_ns : 0;
+    }
+    /* 可持续倍速的估计：包时钟跨度 / 本次回放的处理时长
+     * 只由一次回放推算，处理时长本身随倍速变化（批大小、缓存状态不同），
+     * 不能保证该倍速下落后不会增长；需要确认时在该倍速附近再回放一次
+     */
+    double estimated_sustainable_speedup() const {
+        uint64_t busy = busy_ns();
+        return busy > 0 ? static_cast<double>(trace_span_ns) / busy : 0.0;
+    }
+};
+
+/* 按原始包间隔（或其 speedup 倍速）交付另一个来源的数据包，模拟实时到达
+ * 包在到期前不会交付；消费者处理慢于包时钟时，到期包积压，
+ * 记录每批第一个包到期后多久才被取走，作为处理落后于包时钟的时长
+ */
+class PacedPacketSource : public PacketSource {
+   public:
+    /* @param inner 被回放的来源
+     * @param speedup 包时钟相对墙钟的倍速，1 为原始速度
+     */
+    PacedPacketSource(std::unique_ptr<PacketSource> inner, double speedup);
+
+    size_t next_batch(const PacketRecord*& batch, size_t max_count) override;
+    bool time_bounds(uint64_t& first_ts, uint64_t& last_ts) const override;
+    bool start_time(uint64_t& start_ts) const override;
+
+    // 截至调用时刻的统计，应在消费者处理完全部数据后调用
+    ReplayStats stats() const;
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    std::unique_ptr<PacketSource> inner_;
+    double speedup_;
+
+    // inner_ 当前批中尚未交付的部分
+    const PacketRecord* pending_ = nullptr;
+    size_t pending_count_ = 0;
+
+    bool started_ = false;
+    Clock::time_point wall_start_;
+    uint64_t first_ts_ = 0;
+    uint64_t last_ts_ = 0;  // 最后交付的包的时间戳
+    uint64_t packets_ = 0;
+    uint64_t idle_ns_ = 0;
+    uint64_t max_lag_ns_ = 0;
+    double lag_sum_ = 0.0;  // 每批落后时长乘以包数之和
+
+    // 时间戳为 ts 的包应交付的墙钟时刻
+    Clock::time_point due(uint64_t ts) const;
+};
+
+#endif  // DISKETCH_PACKET_SOURCE_H
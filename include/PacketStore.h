@@ -0,0 +1,92 @@
+#ifndef DISKETCH_PACKET_STORE_H
+#define DISKETCH_PACKET_STORE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "PacketParser.h"
+#include "PacketSource.h"
+
+// 列式（SoA）数据包存储，时间戳与流编号分列保存
+// 构建时把每个流键映射为从 0 开始的稠密编号，逐流状态可以用数组按编号保存
+// 要求数据按时间戳升序，预先建立 epoch 偏移索引，仿真时直接按下标区间处理
+// 实现位于 PacketStore.cpp，对 TwoTuple、FiveTuple、IPv6TwoTuple 显式实例化
+template <typename Key>
+class BasicPacketStore {
+   public:
+    using Record = BasicPacketRecord<Key>;
+
+    BasicPacketStore() = default;
+
+    /* 从按时间排序的记录构造并建立 epoch 索引
+     * @param epoch_duration_ns epoch 时长（纳秒）
+     * @param origin_ts 第一个 epoch 的起始时间戳，0 或晚于第一个包时从第一个包算起
+     */
+    BasicPacketStore(const Record* records,
+                     size_t count,
+                     uint64_t epoch_duration_ns,
+                     uint64_t origin_ts = 0);
+    BasicPacketStore(const std::vector<Record>& packets,
+                     uint64_t epoch_duration_ns,
+                     uint64_t origin_ts = 0);
+
+    // 读空 source 并建立 epoch 索引，epoch 起点取 source 的时钟起点
+    static BasicPacketStore from_source(BasicPacketSource<Key>& source,
+                                        uint64_t epoch_duration_ns);
+
+    // 以新的 epoch 时长重建索引
+    void build_epoch_index(uint64_t epoch_duration_ns, uint64_t origin_ts = 0);
+
+    size_t size() const { return timestamps_.size(); }
+    bool empty() const { return timestamps_.empty(); }
+    const uint64_t* timestamps() const { return timestamps_.data(); }
+    const uint32_t* flow_ids() const { return flow_ids_.data(); }
+
+    // 不同流的数量，编号范围为 [0, flow_count())
+    size_t flow_count() const { return dictionary_.size(); }
+    // 编号对应的流键
+    const Key& flow(uint32_t flow_id) const { return dictionary_[flow_id]; }
+
+    uint64_t epoch_duration() const { return epoch_duration_; }
+    size_t epoch_count() const {
+        return epoch_offsets_.empty() ? 0 : epoch_offsets_.size() - 1;
+    }
+    // 第 epoch 个 epoch 的起始时间戳
+    uint64_t epoch_start(size_t epoch) const {
+        return first_ts_ + epoch * epoch_duration_;
+    }
+    // 第 epoch 个 epoch 的数据包下标区间 [begin, end)
+    size_t epoch_begin(size_t epoch) const { return epoch_offsets_[epoch]; }
+    size_t epoch_end(size_t epoch) const { return epoch_offsets_[epoch + 1]; }
+
+    // 在 [begin, end) 中查找第一个时间戳不小于 ts 的下标
+    size_t lower_bound(uint64_t ts, size_t begin, size_t end) const;
+
+    /* 计算 epoch 内各 subepoch 的下标边界
+     * 与 Fragment 的划分一致：超出最后边界的包都归入最后一个 subepoch
+     * @param offsets 输出 subepoch_count + 1 个边界，第 k 段为 [offsets[k], offsets[k+1])
+     */
+    void subepoch_offsets(size_t epoch,
+                          uint32_t subepoch_count,
+                          uint64_t subepoch_duration,
+                          std::vector<size_t>& offsets) const;
+
+   private:
+    std::vector<uint64_t> timestamps_;    // 时间戳列（纳秒）
+    std::vector<uint32_t> flow_ids_;      // 流编号列
+    std::vector<Key> dictionary_;         // 流编号到流键
+    std::unordered_map<Key, uint32_t, typename FlowKeyTraits<Key>::Hash>
+        interner_;                        // 构建期间使用的流键到编号映射
+    std::vector<size_t> epoch_offsets_;   // 每个 epoch 的起始下标，末尾为 size()
+    uint64_t epoch_duration_ = 0;
+    uint64_t first_ts_ = 0;
+
+    void append(const Record* records, size_t count);
+    // 构建完成后释放编号映射
+    void finish_interning();
+};
+
+using PacketStore = BasicPacketStore<TwoTuple>;
+
+#endif  // DISKETCH_PACKET_STORE_H
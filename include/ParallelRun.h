@@ -0,0 +1,88 @@
+#ifndef DISKETCH_PARALLEL_RUN_H
+#define DISKETCH_PARALLEL_RUN_H
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "SpscRing.h"
+
+/* 在 count 个线程上执行 job(0) ... job(count - 1)，调用线程执行 job(0)
+ * 等待全部完成后按下标顺序重新抛出第一个异常
+ */
+template <typename Job>
+void run_in_parallel(size_t count, const Job& job) {
+    std::vector<std::exception_ptr> errors(count);
+    std::vector<std::thread> workers;
+    workers.reserve(count);
+    for (size_t j = 1; j < count; ++j) {
+        workers.emplace_back([&, j]() {
+            try {
+                job(j);
+            } catch (...) {
+                errors[j] = std::current_exception();
+            }
+        });
+    }
+    try {
+        if (count > 0) {
+            job(0);
+        }
+    } catch (...) {
+        errors[0] = std::current_exception();
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+/* 常驻线程上的 run_in_parallel，用于反复执行的短任务，省去每次创建线程的开销
+ * 语义与 run_in_parallel 相同；两次 run 之间常驻线程睡眠等待唤醒
+ * run 只能由创建者所在的一个线程调用
+ */
+class ParallelRunner {
+   public:
+    // @param threads 含调用线程在内的线程数，另外创建 threads - 1 个常驻线程
+    explicit ParallelRunner(size_t threads);
+    ~ParallelRunner();
+
+    ParallelRunner(const ParallelRunner&) = delete;
+    ParallelRunner& operator=(const ParallelRunner&) = delete;
+
+    size_t threads() const { return workers_.size() + 1; }
+
+    // 执行 job(0) ... job(count - 1)，count 不超过 threads()
+    template <typename Job>
+    void run(size_t count, const Job& job) {
+        dispatch(count, [&job](size_t j) { job(j); });
+    }
+
+   private:
+    struct Worker {
+        std::atomic<bool> ready{false};  // 本轮有任务待执行
+        SpscWaiter wake;                 // 等待 ready 或停止
+        std::exception_ptr error;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    const std::function<void(size_t)>* task_ = nullptr;  // 当前一轮的任务
+    std::atomic<size_t> pending_{0};  // 本轮尚未完成的常驻线程数
+    std::atomic<bool> stop_{false};
+    SpscWaiter done_;  // 调用线程等待 pending_ 归零
+
+    void dispatch(size_t count, const std::function<void(size_t)>& task);
+    // 常驻线程主循环，执行 task(index)
+    void work(size_t index);
+};
+
+#endif  // DISKETCH_PARALLEL_RUN_H
@@ -0,0 +1,88 @@
+#ifndef DISKETCH_READ_AHEAD_FILE_H
+#define DISKETCH_READ_AHEAD_FILE_H
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "SpscRing.h"
+
+/* 顺序读取的预读文件
+ * 后台线程以 O_DIRECT 把文件按大块读入对齐缓冲区，消费者按块取用，
+ * 队列中始终保留若干已读好的块；文件系统不支持 O_DIRECT 时退回普通读取。
+ * 也可以读取外部解压程序的输出管道，解压与解码并行进行
+ */
+class ReadAheadFile {
+   public:
+    /* @param chunk_bytes 每块大小，会向上取整到 4KB 的倍数
+     * @param depth 预读块数
+     */
+    explicit ReadAheadFile(size_t chunk_bytes = 4 * 1024 * 1024,
+                           size_t depth = 8);
+    ~ReadAheadFile();
+
+    ReadAheadFile(const ReadAheadFile&) = delete;
+    ReadAheadFile& operator=(const ReadAheadFile&) = delete;
+
+    // 打开文件并启动预读线程
+    bool open(const std::string& path);
+
+    /* 启动 `program -dc path` 并预读其标准输出
+     * @param program 解压程序名，如 gzip、zstd、xz，按 PATH 查找
+     * @return 无法启动程序时返回 false；解压失败在 next_chunk 中报告
+     */
+    bool open_decompressed(const std::string& path, const std::string& program);
+
+    /* 取得下一块数据，同时归还上一块
+     * @return 文件读完时返回 false；读取出错时抛出 std::runtime_error
+     */
+    bool next_chunk(const uint8_t*& data, size_t& size);
+
+    // 停止预读并关闭文件
+    void close();
+
+    bool is_open() const { return fd_ >= 0; }
+    // 是否读取解压程序的输出
+    bool decompressing() const { return child_ > 0; }
+    // 是否以 O_DIRECT 绕过页缓存
+    bool direct() const { return direct_.load(std::memory_order_relaxed); }
+    // 文件大小，读取解压输出时为 0
+    size_t file_size() const { return file_size_; }
+
+   private:
+    struct AlignedFree {
+        void operator()(uint8_t* p) const;
+    };
+
+    struct Chunk {
+        std::unique_ptr<uint8_t, AlignedFree> buffer;  // 对齐缓冲区，首次使用时分配
+        size_t size = 0;                               // 有效字节数
+    };
+
+    size_t chunk_bytes_;
+    SpscRing<Chunk> ring_;
+    int fd_ = -1;
+    std::atomic<bool> direct_{false};
+    size_t file_size_ = 0;
+    pid_t child_ = -1;      // 解压程序进程，只在 close() 中回收
+    std::string program_;   // 解压程序名，用于错误信息
+    bool holding_ = false;  // 消费者是否持有一个未归还的块
+
+    std::thread reader_;
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> reader_done_{false};
+    std::string read_error_;  // 预读线程遇到的错误，为空表示没有错误
+
+    // 启动预读线程
+    void start();
+    void read_ahead();
+    // 数据读完后检查解压程序是否正常退出
+    void check_child();
+};
+
+#endif  // DISKETCH_READ_AHEAD_FILE_H
@@ -0,0 +1,160 @@
+#ifndef DISKETCH_SPSC_RING_H
+#define DISKETCH_SPSC_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* 等待与唤醒：等待方先自旋、再让出时间片，预算用尽后睡眠在条件变量上
+ * 等待条件依赖的状态改变之后，修改方调用 notify()；
+ * 没有睡眠的等待方时 notify() 只多一次内存屏障
+ */
+class SpscWaiter {
+   public:
+    // 等待 ready() 为真，ready 只读取原子变量
+    template <typename Ready>
+    void wait(const Ready& ready) {
+        for (unsigned spins = 0; spins < kSpinBudget; ++spins) {
+            if (ready()) {
+                return;
+            }
+            if (spins >= kBusySpins) {
+                std::this_thread::yield();
+            }
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        sleepers_.fetch_add(1, std::memory_order_relaxed);
+        // 与 notify() 中的屏障配对：修改方看不到 sleepers_ 时，
+        // 这里之后的 ready() 一定能看到修改
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cv_.wait(lock, ready);
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // 唤醒全部睡眠中的等待方
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        // 等待方检查条件与进入睡眠都在锁内，加锁后通知不会丢失
+        { std::lock_guard<std::mutex> lock(mutex_); }
+        cv_.notify_all();
+    }
+
+   private:
+    static constexpr unsigned kBusySpins = 64;
+    static constexpr unsigned kSpinBudget = 1024;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic<unsigned> sleepers_{0};
+};
+
+/* 单生产者单消费者的无锁环形队列
+ * 槽位预先分配，生产者原地填充后发布，消费者原地读取后归还，不在两端之间拷贝元素
+ * 只允许一个线程调用 producer 侧接口，另一个线程调用 consumer 侧接口
+ */
+template <typename T>
+class SpscRing {
+   public:
+    explicit SpscRing(size_t capacity)
+        : slots_(capacity < 2 ? 2 : capacity), head_(0), tail_(0) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return slots_.size(); }
+
+    // 生产者：取得下一个可写槽位，队列已满时返回 nullptr
+    T* try_acquire() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= slots_.size()) {
+            return nullptr;
+        }
+        return &slots_[head % slots_.size()];
+    }
+
+    // 生产者：发布 try_acquire 取得的槽位
+    void publish() {
+        head_.fetch_add(1, std::memory_order_release);
+        readable_.notify();
+    }
+
+    /* 生产者：等待可写槽位，队列满时先自旋，之后睡眠到消费者归还槽位
+     * stop() 为真时返回 nullptr；stop 依赖的状态改变后须调用 wake()
+     */
+    template <typename Stop>
+    T* wait_acquire(const Stop& stop) {
+        T* slot = nullptr;
+        writable_.wait([&]() {
+            slot = try_acquire();
+            return slot != nullptr || stop();
+        });
+        return slot;
+    }
+
+    // 消费者：取得最早发布的槽位，队列为空时返回 nullptr
+    T* try_front() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots_[tail % slots_.size()];
+    }
+
+    // 消费者：归还 try_front 取得的槽位
+    void release() {
+        tail_.fetch_add(1, std::memory_order_release);
+        writable_.notify();
+    }
+
+    /* 消费者：等待已发布的槽位，队列空时先自旋，之后睡眠到生产者发布
+     * done() 为真且队列已空时返回 nullptr；done 依赖的状态改变后须调用 wake()
+     */
+    template <typename Done>
+    T* wait_front(const Done& done) {
+        T* slot = nullptr;
+        readable_.wait([&]() {
+            slot = try_front();
+            return slot != nullptr || done();
+        });
+        // 结束标志在最后一次发布之后置位，先读到标志时再确认一次队列
+        return slot != nullptr ? slot : try_front();
+    }
+
+    // 唤醒两端的等待方，用于 stop/done 依赖的外部状态改变之后
+    void wake() {
+        readable_.notify();
+        writable_.notify();
+    }
+
+   private:
+    std::vector<T> slots_;
+    // 生产者与消费者的计数器分处不同缓存行，避免伪共享
+    std::atomic<size_t> head_;
+    char padding_[64];
+    std::atomic<size_t> tail_;
+    SpscWaiter readable_;  // 消费者等待新的发布
+    SpscWaiter writable_;  // 生产者等待空闲槽位
+};
+
+// 等待循环的退避：先自旋，再让出时间片，长时间等待时短暂休眠
+// 只用于还要检查截止时间等外部条件、无人通知的轮询；队列两端的等待用 SpscWaiter
+inline void spsc_backoff(unsigned& spins) {
+    ++spins;
+    if (spins < 64) {
+        return;
+    }
+    if (spins < 1024) {
+        std::this_thread::yield();
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+#endif  // DISKETCH_SPSC_RING_H
@@ -0,0 +1,93 @@
+#ifndef DISKETCH_SYNTHETIC_TRACE_H
+#define DISKETCH_SYNTHETIC_TRACE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "PacketParser.h"
+#include "PacketSource.h"
+
+// 合成流量配置
+struct SyntheticTraceConfig {
+    bool enabled = false;           // 使用合成流量代替 pcap 输入
+    uint64_t packets = 10000000;    // 总包数
+    uint64_t flows = 1000000;       // 流的数量
+    double zipf_alpha = 1.0;        // 流大小 Zipf 分布的指数，越大越偏斜
+    double rate_pps = 10000000.0;   // 包速率（包/秒），决定时间跨度
+    uint64_t start_ns = 0;          // 第一个包的时间戳（纳秒）
+    bool poisson = false;           // 包间隔服从指数分布，否则等间隔
+    uint64_t seed = 1;              // 随机种子，相同配置生成相同的 trace
+};
+
+/* Zipf 分布采样器，返回 [1, n] 中的排名，排名 k 的概率正比于 k^-alpha
+ * 使用 Hörmann 与 Derflinger 的拒绝-反演方法，期望 O(1) 时间、不需要概率表，
+ * 流数量到 10^9 也不额外占用内存
+ */
+class ZipfSampler {
+   public:
+    ZipfSampler(uint64_t n, double alpha);
+
+    // next_uniform 返回 [0, 1) 上的均匀随机数，拒绝时会被多次调用
+    template <typename Uniform>
+    uint64_t sample(Uniform& next_uniform) const {
+        while (true) {
+            double u = h_integral_n_ +
+                       next_uniform() * (h_integral_x1_ - h_integral_n_);
+            double x = h_integral_inverse(u);
+            double k = static_cast<double>(static_cast<uint64_t>(x + 0.5));
+            if (k < 1.0) {
+                k = 1.0;
+            } else if (k > n_) {
+                k = n_;
+            }
+            if (k - x <= s_ || u >= h_integral(k + 0.5) - h(k)) {
+                return static_cast<uint64_t>(k);
+            }
+        }
+    }
+
+   private:
+    double n_;
+    double alpha_;
+    double h_integral_x1_;
+    double h_integral_n_;
+    double s_;
+
+    double h(double x) const;
+    double h_integral(double x) const;
+    double h_integral_inverse(double x) const;
+};
+
+/* 确定性的合成流量来源，逐批直接生成记录，不经过磁盘和解析
+ * 流大小服从 Zipf 分布，排名经双射混合后映射为二元组，大流不会集中在相邻地址
+ */
+class SyntheticPacketSource : public PacketSource {
+   public:
+    explicit SyntheticPacketSource(const SyntheticTraceConfig& config);
+
+    size_t next_batch(const PacketRecord*& batch, size_t max_count) override;
+    bool time_bounds(uint64_t& first_ts, uint64_t& last_ts) const override;
+
+    // 排名为 rank 的流对应的二元组
+    TwoTuple flow_of(uint64_t rank) const;
+
+   private:
+    SyntheticTraceConfig config_;
+    ZipfSampler zipf_;
+    uint64_t rng_state_;
+    uint64_t generated_ = 0;
+    double interval_ns_;  // 平均包间隔
+    double clock_ns_;     // 泊松到达时的当前时间
+    std::vector<PacketRecord> buffer_;
+
+    // [0, 1) 上的均匀随机数
+    double next_uniform();
+};
+
+/* 生成完整的合成 trace
+ * 包数较多时应直接使用 SyntheticPacketSource，避免占用内存
+ */
+PacketParser::PacketVector generate_synthetic_trace(
+    const SyntheticTraceConfig& config);
+
+#endif  // DISKETCH_SYNTHETIC_TRACE_H
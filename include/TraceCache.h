@@ -0,0 +1,107 @@
+#ifndef DISKETCH_TRACE_CACHE_H
+#define DISKETCH_TRACE_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "MappedFile.h"
+#include "PacketParser.h"
+#include "PacketSource.h"
+
+// 缓存记录直接按 PacketRecord 的内存布局落盘，映射后零拷贝使用
+static_assert(sizeof(PacketRecord) == 16, "unexpected PacketRecord layout");
+static_assert(std::is_trivially_copyable<PacketRecord>::value,
+              "PacketRecord must be trivially copyable");
+
+// 源文件指纹，用于判断缓存或索引是否仍与源文件一致
+struct SourceFingerprint {
+    uint64_t size = 0;     // 文件大小
+    int64_t mtime_ns = 0;  // 修改时间（纳秒）
+    uint64_t hash = 0;     // 首尾各 64KB 的 FNV-1a 哈希
+};
+
+/* 读取源文件的大小、修改时间和采样哈希
+ * 只哈希首尾各 64KB，避免为了校验缓存而完整读一遍 pcap
+ */
+bool fingerprint_source(const std::string& source_path,
+                        SourceFingerprint& fingerprint);
+
+// 缓存文件头，紧跟其后的是按时间排序的 PacketRecord 数组
+struct TraceCacheHeader {
+    char magic[8];             // 固定为 "DSKTRACE"
+    uint32_t version;          // 格式版本
+    uint32_t record_size;      // 单条记录字节数，用于检查布局
+    uint64_t packet_count;     // 数据包数量
+    uint64_t first_ts;         // 第一个包的时间戳（纳秒）
+    uint64_t last_ts;          // 最后一个包的时间戳（纳秒）
+    uint64_t source_size;      // 源 pcap 文件大小
+    int64_t source_mtime_ns;   // 源 pcap 修改时间（纳秒）
+    uint64_t source_hash;      // 源 pcap 首尾各 64KB 的 FNV-1a 哈希
+};
+
+static_assert(sizeof(TraceCacheHeader) == 64,
+              "TraceCacheHeader must keep records 8-byte aligned");
+
+// 已解析 trace 的二进制缓存，校验通过后以 mmap 方式加载
+class TraceCache {
+   public:
+    // 默认缓存路径：源文件路径加 ".cache" 后缀
+    static std::string default_path(const std::string& source_path);
+
+    /* 映射缓存文件并与源 pcap 比对大小、修改时间和采样哈希
+     * @param cache_path 缓存文件路径
+     * @param source_path 源 pcap 文件路径
+     * @return 缓存存在且与源文件一致时返回 true
+     */
+    bool open(const std::string& cache_path, const std::string& source_path);
+
+    /* 将已排序的解析结果写入缓存，先写临时文件再原子替换
+     * @return 写入成功返回 true
+     */
+    static bool write(const std::string& cache_path,
+                      const std::string& source_path,
+                      const PacketParser::PacketVector& packets);
+
+    /* 优先读取缓存，缓存缺失或失效时解析 pcap 并重建缓存
+     * @param hit 输出是否命中缓存，可为空
+     */
+    static PacketParser::PacketVector load_or_parse(
+        const std::string& source_path,
+        const std::string& cache_path,
+        const PacketParser& parser,
+        bool* hit = nullptr);
+
+    void close();
+
+    bool is_open() const { return file_.is_open(); }
+    const PacketRecord* data() const { return records_; }
+    size_t size() const { return count_; }
+    uint64_t first_ts() const { return first_ts_; }
+    uint64_t last_ts() const { return last_ts_; }
+
+    // 拷贝为 PacketVector，供需要可修改数据的调用方使用
+    PacketParser::PacketVector to_vector() const;
+
+   private:
+    MappedFile file_;
+    const PacketRecord* records_ = nullptr;
+    size_t count_ = 0;
+    uint64_t first_ts_ = 0;
+    uint64_t last_ts_ = 0;
+};
+
+// 直接遍历映射中的缓存记录，不拷贝数据
+class CachedPacketSource : public PacketSource {
+   public:
+    explicit CachedPacketSource(const TraceCache& cache);
+
+    size_t next_batch(const PacketRecord*& batch, size_t max_count) override;
+    bool time_bounds(uint64_t& first_ts, uint64_t& last_ts) const override;
+
+   private:
+    const TraceCache& cache_;
+    size_t position_ = 0;
+};
+
+#endif  // DISKETCH_TRACE_CACHE_H
@@ -0,0 +1,90 @@
+#ifndef DISKETCH_TRACE_INDEX_H
+#define DISKETCH_TRACE_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TraceCache.h"
+
+// 索引文件头，紧跟其后的是 checkpoint_count 个 TraceIndexCheckpoint
+struct TraceIndexHeader {
+    char magic[8];              // 固定为 "DSKINDEX"
+    uint32_t version;           // 格式版本
+    uint32_t record_interval;   // 相邻检查点之间的记录数
+    uint64_t checkpoint_count;  // 检查点数量，含末尾的文件结束位置
+    uint64_t first_ts;          // 全部记录中最早的时间戳（纳秒）
+    uint64_t last_ts;           // 全部记录中最晚的时间戳（纳秒）
+    uint64_t source_size;       // 源 pcap 文件大小
+    int64_t source_mtime_ns;    // 源 pcap 修改时间（纳秒）
+    uint64_t source_hash;       // 源 pcap 首尾各 64KB 的 FNV-1a 哈希
+};
+
+static_assert(sizeof(TraceIndexHeader) == 64,
+              "TraceIndexHeader must keep checkpoints 8-byte aligned");
+
+/* 检查点：记录头偏移与两侧时间戳的界
+ * 允许记录局部乱序：offset 之前的记录都早于或等于 prefix_max_ts，
+ * offset 及之后的记录都不早于 suffix_min_ts
+ */
+struct TraceIndexCheckpoint {
+    uint64_t offset;         // 记录头在文件中的偏移
+    uint64_t prefix_max_ts;  // offset 之前记录的最大时间戳，没有记录时为 0
+    uint64_t suffix_min_ts;  // offset 及之后记录的最小时间戳，没有记录时为最大值
+};
+
+/* 经典 pcap 的旁路时间索引，每隔固定记录数保存一个检查点
+ * 按时间范围查询可以直接得到需要读取的字节区间，不必解析之前的全部数据
+ * pcapng 与压缩文件只能顺序读取，不建立索引
+ */
+class TraceIndex {
+   public:
+    // 默认索引路径：源文件路径加 ".idx" 后缀
+    static std::string default_path(const std::string& source_path);
+
+    /* 读取索引并与源 pcap 比对指纹
+     * @return 索引存在且与源文件一致时返回 true
+     */
+    bool open(const std::string& index_path, const std::string& source_path);
+
+    /* 只遍历记录头建立索引，先写临时文件再原子替换
+     * @param record_interval 相邻检查点之间的记录数
+     * @return 源文件不是经典 pcap 或写入失败时返回 false
+     */
+    static bool build(const std::string& source_path,
+                      const std::string& index_path,
+                      uint32_t record_interval = 16384);
+
+    /* 优先读取默认路径的索引，缺失或失效时重建
+     * @return 源文件不能建立索引时返回 false
+     */
+    bool load_or_build(const std::string& source_path);
+
+    /* 查询时间戳落在 [begin_ts, end_ts) 内的记录所在的字节区间
+     * 区间以记录边界对齐，可能包含少量范围外的记录，调用方仍需按时间戳过滤
+     * @param end_ts 为 0 时表示不限
+     */
+    void byte_range(uint64_t begin_ts,
+                    uint64_t end_ts,
+                    size_t& begin,
+                    size_t& end) const;
+
+    bool is_open() const { return !checkpoints_.empty(); }
+    uint64_t first_ts() const { return first_ts_; }
+    uint64_t last_ts() const { return last_ts_; }
+    size_t checkpoint_count() const { return checkpoints_.size(); }
+
+   private:
+    std::vector<TraceIndexCheckpoint> checkpoints_;
+    uint64_t first_ts_ = 0;
+    uint64_t last_ts_ = 0;
+};
+
+/* 一组 trace 中最早的时间戳
+ * 经典 pcap 从索引读取（必要时建立索引），其他格式读取第一条记录的时间戳
+ * @return 所有文件都没有记录时返回 false
+ */
+bool trace_start_time(const std::vector<std::string>& paths,
+                      uint64_t& first_ts);
+
+#endif  // DISKETCH_TRACE_INDEX_H
@@ -0,0 +1,167 @@
+#include "CompressedTrace.h"
+
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+
+inline void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline uint64_t get_varint(const uint8_t*& in) {
+    uint64_t value = *in & 0x7f;
+    unsigned shift = 7;
+    while (*in++ & 0x80) {
+        value |= static_cast<uint64_t>(*in & 0x7f) << shift;
+        shift += 7;
+    }
+    return value;
+}
+
+// 有符号差值映射为无符号数，小幅乱序也只占一两个字节
+inline uint64_t zigzag_encode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^
+           static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzag_decode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+}  // namespace
+
+constexpr size_t CompressedTrace::kBlockSize;
+
+CompressedTrace::CompressedTrace(const PacketRecord* records, size_t count) {
+    encode(records, count);
+}
+
+CompressedTrace::CompressedTrace(const PacketParser::PacketVector& packets)
+    : CompressedTrace(packets.data(), packets.size()) {}
+
+void CompressedTrace::encode(const PacketRecord* records, size_t count) {
+    packet_count_ = count;
+    if (count == 0) {
+        return;
+    }
+    first_ts_ = records[0].timestamp.count();
+    last_ts_ = records[count - 1].timestamp.count();
+
+    // 第一遍统计各流包数，按频次从高到低分配下标，大流只占一个字节
+    std::unordered_map<TwoTuple, uint32_t, TwoTupleHash> first_seen;
+    std::vector<uint64_t> frequency;
+    std::vector<uint32_t> ids(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto it = first_seen
+                      .emplace(records[i].flow,
+                               static_cast<uint32_t>(dictionary_.size()))
+                      .first;
+        if (it->second == dictionary_.size()) {
+            dictionary_.push_back(records[i].flow);
+            frequency.push_back(0);
+        }
+        ids[i] = it->second;
+        frequency[it->second] += 1;
+    }
+    std::unordered_map<TwoTuple, uint32_t, TwoTupleHash>().swap(first_seen);
+
+    std::vector<uint32_t> order(dictionary_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&frequency](uint32_t a, uint32_t b) {
+                         return frequency[a] > frequency[b];
+                     });
+    std::vector<uint32_t> rank(order.size());
+    std::vector<TwoTuple> ranked(order.size());
+    for (uint32_t r = 0; r < order.size(); ++r) {
+        rank[order[r]] = r;
+        ranked[r] = dictionary_[order[r]];
+    }
+    dictionary_.swap(ranked);
+
+    // 第二遍按块写出 varint 流
+    bytes_.reserve(count * 3);
+    blocks_.reserve((count + kBlockSize - 1) / kBlockSize);
+    uint64_t prev_ts = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t ts = records[i].timestamp.count();
+        if (i % kBlockSize == 0) {
+            blocks_.push_back(
+                {ts, bytes_.size(),
+                 static_cast<uint32_t>(std::min(kBlockSize, count - i))});
+            prev_ts = ts;
+        }
+        put_varint(bytes_, zigzag_encode(static_cast<int64_t>(ts - prev_ts)));
+        put_varint(bytes_, rank[ids[i]]);
+        prev_ts = ts;
+    }
+    bytes_.shrink_to_fit();
+}
+
+size_t CompressedTrace::memory_bytes() const {
+    return bytes_.size() + blocks_.size() * sizeof(Block) +
+           dictionary_.size() * sizeof(TwoTuple);
+}
+
+double CompressedTrace::bytes_per_packet() const {
+    return packet_count_ == 0
+               ? 0.0
+               : static_cast<double>(memory_bytes()) / packet_count_;
+}
+
+size_t CompressedTrace::decode_block(size_t block, PacketRecord* out) const {
+    const Block& info = blocks_[block];
+    const uint8_t* in = bytes_.data() + info.offset;
+    const TwoTuple* dictionary = dictionary_.data();
+    uint64_t ts = info.first_ts;
+    for (uint32_t i = 0; i < info.count; ++i) {
+        ts += static_cast<uint64_t>(zigzag_decode(get_varint(in)));
+        out[i].flow = dictionary[get_varint(in)];
+        out[i].timestamp = std::chrono::nanoseconds(ts);
+    }
+    return info.count;
+}
+
+CompressedPacketSource::CompressedPacketSource(const CompressedTrace& trace,
+                                               uint64_t origin_ts)
+    : trace_(trace),
+      origin_ts_(origin_ts),
+      buffer_(CompressedTrace::kBlockSize) {}
+
+size_t CompressedPacketSource::next_batch(const PacketRecord*& batch,
+                                          size_t max_count) {
+    if (position_ >= decoded_) {
+        if (next_block_ >= trace_.block_count()) {
+            return 0;
+        }
+        decoded_ = trace_.decode_block(next_block_++, buffer_.data());
+        position_ = 0;
+    }
+    size_t count = std::min(max_count, decoded_ - position_);
+    batch = buffer_.data() + position_;
+    position_ += count;
+    return count;
+}
+
+bool CompressedPacketSource::time_bounds(uint64_t& first_ts,
+                                         uint64_t& last_ts) const {
+    if (trace_.empty()) {
+        return false;
+    }
+    first_ts = trace_.first_ts();
+    last_ts = trace_.last_ts();
+    return true;
+}
+
+bool CompressedPacketSource::start_time(uint64_t& start_ts) const {
+    if (origin_ts_ == 0 || trace_.empty() || origin_ts_ > trace_.first_ts()) {
+        return false;
+    }
+    start_ts = origin_ts_;
+    return true;
+}
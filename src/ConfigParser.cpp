@@ -1,5 +1,12 @@
 #include "ConfigParser.h"
 
+#include <glob.h>
+
+#include <limits>
+#include <thread>
+
+#include "TraceCache.h"
+
 bool ConfigParser::parse(const std::string& ini_path, DiSketchConfig& config) {
     CSimpleIniA ini;
     ini.SetUnicode();
@@ -10,9 +17,25 @@ bool ConfigParser::parse(const std::string& ini_path, DiSketchConfig& config) {
         return false;
     }
 
-    // 解析全局配置
+    // 解析全局配置，启用合成流量、实时抓包或流记录时不需要 pcap
+    read_synthetic(ini, config.synthetic);
+    read_capture(ini, config.capture);
+    read_flows(ini, config.flows);
+    int alternative_inputs = static_cast<int>(config.synthetic.enabled) +
+                             static_cast<int>(config.capture.enabled) +
+                             static_cast<int>(config.flows.enabled);
+    if (alternative_inputs > 1) {
+        std::cerr << "synthetic、capture 与 flows 只能启用一个" << std::endl;
+        return false;
+    }
+    if (config.flows.enabled &&
+        !expand_input_paths(config.flows.path, config.flows.paths)) {
+        std::cerr << "配置缺少流记录路径" << std::endl;
+        return false;
+    }
     config.pcap_path = ini.GetValue("global", "pcap", "");
-    if (config.pcap_path.empty()) {
+    if (alternative_inputs == 0 &&
+        !expand_input_paths(config.pcap_path, config.pcap_paths)) {
         std::cerr << "配置缺少 pcap 路径" << std::endl;
         return false;
     }
@@ -24,12 +47,140 @@ bool ConfigParser::parse(const std::string& ini_path, DiSketchConfig& config) {
     config.epoch_duration_ns =
         ini.GetLongValue("global", "epoch_ns", 1000000000);
     config.max_epochs = ini.GetLongValue("global", "max_epochs", 0);
+    config.start_epoch = ini.GetLongValue("global", "start_epoch", 0);
+    config.start_time_ns = static_cast<uint64_t>(
+        ini.GetDoubleValue("global", "start_time_ns", 0.0));
     config.full_sketch_depth =
         ini.GetLongValue("global", "full_sketch_depth", 8);
     config.heavy_hitter_ratio =
         ini.GetDoubleValue("global", "heavy_ratio", 0.0001);
     config.enable_progress_bar =
         parse_bool(ini.GetValue("global", "progress_bar", "true"));
+    std::string read_mode = ini.GetValue("global", "read_mode", "mmap");
+    if (read_mode == "stream") {
+        config.parser.read_mode = PcapReadMode::Stream;
+    } else if (read_mode == "direct") {
+        config.parser.read_mode = PcapReadMode::Direct;
+    } else {
+        config.parser.read_mode = PcapReadMode::Mmap;
+    }
+    config.parser.parse_threads =
+        read_count(ini, "global", "parse_threads", 1, max_threads());
+    config.stream_input =
+        parse_bool(ini.GetValue("global", "stream", "false"));
+    config.parser.reorder_window =
+        ini.GetLongValue("global", "reorder_window", 65536);
+    config.trace_cache =
+        parse_bool(ini.GetValue("global", "trace_cache", "false"));
+    // 缓存对应展开后的文件，通配符只匹配一个文件时也以该文件命名
+    config.trace_cache_path = ini.GetValue(
+        "global", "trace_cache_path",
+        TraceCache::default_path(config.pcap_paths.empty()
+                                     ? config.pcap_path
+                                     : config.pcap_paths[0])
+            .c_str());
+    if (config.trace_cache && config.pcap_paths.size() > 1) {
+        // 缓存按单个源文件校验
+        std::cerr << "多个 pcap 输入时不使用 trace_cache" << std::endl;
+        config.trace_cache = false;
+    }
+    config.compress_trace =
+        parse_bool(ini.GetValue("global", "compress_trace", "false"));
+    config.pipeline = parse_bool(ini.GetValue("global", "pipeline", "false"));
+    config.replay_speedup =
+        ini.GetDoubleValue("global", "replay_speedup", 0.0);
+    if (config.replay_speedup < 0.0) {
+        config.replay_speedup = 0.0;
+    }
+    config.flow_key =
+        parse_flow_key_kind(ini.GetValue("global", "flow_key", "two_tuple"));
+    std::string sample_mode = ini.GetValue("global", "sample_mode", "none");
+    if (sample_mode == "deterministic") {
+        config.sampling.mode = SamplingMode::Deterministic;
+    } else if (sample_mode == "hash") {
+        config.sampling.mode = SamplingMode::Hash;
+    } else {
+        config.sampling.mode = SamplingMode::None;
+    }
+    config.sampling.rate =
+        read_count(ini, "global", "sample_rate", 1,
+                   std::numeric_limits<uint32_t>::max());
+    config.sampling.seed = ini.GetLongValue("global", "sample_seed", 0);
+    if (config.sampling.rate == 0) {
+        config.sampling.rate = 1;
+    }
+    config.fragment_threads =
+        read_count(ini, "global", "fragment_threads", 0, max_threads());
+    config.eval_threads =
+        read_count(ini, "global", "eval_threads", 0, max_threads());
+    config.eval_queue = read_count(ini, "global", "eval_queue", 0,
+                                   EpochEvaluator::kMaxDepth);
+    config.epoch_threads =
+        read_count(ini, "global", "epoch_threads", 0, max_threads());
+    if (config.flows.enabled) {
+        // 流记录整体读入内存并按二元组带权更新，不经过逐包的输入路径
+        if (config.stream_input || config.pipeline || config.compress_trace ||
+            config.replay_speedup > 0.0 || config.start_epoch > 0 ||
+            config.start_time_ns > 0 || config.sampling.enabled() ||
+            config.flow_key != FlowKeyKind::TwoTuple) {
+            std::cerr << "流记录输入忽略 stream、pipeline、compress_trace、"
+                         "replay_speedup、start_epoch、start_time_ns 与 "
+                         "sample_mode，流键固定为 two_tuple"
+                      << std::endl;
+        }
+        config.sampling = SamplingConfig();
+        config.stream_input = false;
+        config.pipeline = false;
+        config.trace_cache = false;
+        config.compress_trace = false;
+        config.replay_speedup = 0.0;
+        config.start_epoch = 0;
+        config.start_time_ns = 0;
+        config.flow_key = FlowKeyKind::TwoTuple;
+    }
+    if (config.flow_key != FlowKeyKind::TwoTuple &&
+        (config.stream_input || config.pipeline || config.trace_cache ||
+         config.compress_trace || config.replay_speedup > 0.0)) {
+        // 流式来源、缓存与压缩格式都按二元组记录设计
+        std::cerr << "stream、pipeline、trace_cache、compress_trace 与 "
+                     "replay_speedup 只支持 two_tuple 流键，已忽略"
+                  << std::endl;
+        config.stream_input = false;
+        config.pipeline = false;
+        config.trace_cache = false;
+        config.compress_trace = false;
+        config.replay_speedup = 0.0;
+    }
+    if (config.synthetic.enabled &&
+        (config.trace_cache || config.flow_key != FlowKeyKind::TwoTuple)) {
+        // 合成流量只生成二元组，也没有可缓存的源文件
+        std::cerr << "合成流量不使用 trace_cache，流键固定为 two_tuple"
+                  << std::endl;
+        config.trace_cache = false;
+        config.flow_key = FlowKeyKind::TwoTuple;
+    }
+    bool has_start = config.start_epoch > 0 || config.start_time_ns > 0;
+    if (has_start && (config.synthetic.enabled || config.capture.enabled)) {
+        std::cerr << "合成流量与实时抓包忽略 start_epoch 和 start_time_ns"
+                  << std::endl;
+        config.start_epoch = 0;
+        config.start_time_ns = 0;
+    } else if (has_start && config.trace_cache) {
+        // 缓存保存完整 trace，只截取一段时不读也不写缓存
+        std::cerr << "指定起始位置时不使用 trace_cache" << std::endl;
+        config.trace_cache = false;
+    }
+    if (config.capture.enabled) {
+        // 实时抓包总是边抓边算，只输出二元组
+        if (config.flow_key != FlowKeyKind::TwoTuple ||
+            config.replay_speedup > 0.0) {
+            std::cerr << "实时抓包忽略 replay_speedup，流键固定为 two_tuple"
+                      << std::endl;
+        }
+        config.flow_key = FlowKeyKind::TwoTuple;
+        config.replay_speedup = 0.0;
+        config.trace_cache = false;
+    }
 
     // 解析所有 fragment 配置
     CSimpleIniA::TNamesDepend sections;
@@ -79,6 +230,8 @@ bool ConfigParser::parse(const std::string& ini_path, DiSketchConfig& config) {
         std::string boost_str =
             ini.GetValue(section_name.c_str(), "boost_single_hop", "false");
         frag.boost_single_hop = parse_bool(boost_str);
+        frag.ingest_shards = read_count(ini, section_name.c_str(),
+                                        "ingest_shards", 1, max_threads());
 
         // 验证并修正配置
         if (frag.depth == 0) {
@@ -87,6 +240,16 @@ bool ConfigParser::parse(const std::string& ini_path, DiSketchConfig& config) {
         if (frag.max_subepoch < frag.initial_subepoch) {
             frag.max_subepoch = frag.initial_subepoch;
         }
+        if (frag.ingest_shards == 0) {
+            frag.ingest_shards = 1;
+        }
+        if (frag.ingest_shards > 1 &&
+            !Fragment::supports_ingest_shards(frag.kind)) {
+            std::cerr << "fragment " << frag.name
+                      << " 的 sketch 不能按计数器合并，ingest_shards 必须为 1"
+                      << std::endl;
+            return false;
+        }
 
         fragment_index[frag.name] =
             static_cast<int>(config.topology.fragments.size());
@@ -154,9 +317,155 @@ bool ConfigParser::parse(const std::string& ini_path, DiSketchConfig& config) {
         return false;
     }
 
+    if (config.eval_threads > 1 && !DiSketch::supports_eval_threads(config)) {
+        std::cerr << "UnivMon 的查询不保证只读，不能多线程评估，"
+                     "eval_threads 已忽略"
+                  << std::endl;
+        config.eval_threads = 0;
+    }
+
     return true;
 }
 
+bool ConfigParser::parse_synthetic(const std::string& ini_path,
+                                   SyntheticTraceConfig& synthetic) {
+    CSimpleIniA ini;
+    ini.SetUnicode();
+
+    SI_Error rc = ini.LoadFile(ini_path.c_str());
+    if (rc < 0) {
+        std::cerr << "无法打开配置文件: " << ini_path << std::endl;
+        return false;
+    }
+    read_synthetic(ini, synthetic);
+    return true;
+}
+
+void ConfigParser::read_synthetic(const CSimpleIniA& ini,
+                                  SyntheticTraceConfig& synthetic) const {
+    synthetic = SyntheticTraceConfig();
+    if (ini.GetSectionSize("synthetic") < 0) {
+        return;
+    }
+    synthetic.enabled =
+        parse_bool(ini.GetValue("synthetic", "enabled", "true"));
+    synthetic.flows = ini.GetLongValue("synthetic", "flows", synthetic.flows);
+    synthetic.zipf_alpha =
+        ini.GetDoubleValue("synthetic", "zipf_alpha", synthetic.zipf_alpha);
+    synthetic.rate_pps =
+        ini.GetDoubleValue("synthetic", "rate_pps", synthetic.rate_pps);
+    synthetic.start_ns =
+        ini.GetLongValue("synthetic", "start_ns", synthetic.start_ns);
+    synthetic.poisson = parse_bool(ini.GetValue("synthetic", "poisson", "false"));
+    synthetic.seed = ini.GetLongValue("synthetic", "seed", synthetic.seed);
+
+    // 给出时间跨度时由速率推算包数，否则使用 packets
+    double duration_ns = ini.GetDoubleValue("synthetic", "duration_ns", 0.0);
+    if (duration_ns > 0.0) {
+        synthetic.packets =
+            static_cast<uint64_t>(synthetic.rate_pps * duration_ns / 1e9);
+    } else {
+        synthetic.packets = static_cast<uint64_t>(ini.GetDoubleValue(
+            "synthetic", "packets", static_cast<double>(synthetic.packets)));
+    }
+
+    // 验证并修正配置
+    if (synthetic.flows == 0) {
+        synthetic.flows = 1;
+    }
+    if (synthetic.zipf_alpha <= 0.0) {
+        std::cerr << "zipf_alpha 必须为正数，已使用 1.0" << std::endl;
+        synthetic.zipf_alpha = 1.0;
+    }
+    if (synthetic.rate_pps <= 0.0) {
+        std::cerr << "rate_pps 必须为正数，已使用 1e7" << std::endl;
+        synthetic.rate_pps = 1e7;
+    }
+}
+
+void ConfigParser::read_capture(const CSimpleIniA& ini,
+                                LiveCaptureConfig& capture) const {
+    capture = LiveCaptureConfig();
+    if (ini.GetSectionSize("capture") < 0) {
+        return;
+    }
+    capture.enabled = parse_bool(ini.GetValue("capture", "enabled", "true"));
+    capture.interface =
+        ini.GetValue("capture", "interface", capture.interface.c_str());
+    capture.duration_ns =
+        ini.GetLongValue("capture", "duration_ns", capture.duration_ns);
+    capture.ring_batches =
+        ini.GetLongValue("capture", "ring_batches", capture.ring_batches);
+    capture.batch_size =
+        ini.GetLongValue("capture", "batch_size", capture.batch_size);
+    capture.flush_ns = ini.GetLongValue("capture", "flush_ns", capture.flush_ns);
+    capture.socket_buffer =
+        ini.GetLongValue("capture", "socket_buffer", capture.socket_buffer);
+    capture.promiscuous =
+        parse_bool(ini.GetValue("capture", "promiscuous", "false"));
+
+    // 验证并修正配置
+    if (capture.batch_size == 0) {
+        capture.batch_size = 1;
+    }
+}
+
+void ConfigParser::read_flows(const CSimpleIniA& ini,
+                              FlowRecordConfig& flows) const {
+    flows = FlowRecordConfig();
+    if (ini.GetSectionSize("flows") < 0) {
+        return;
+    }
+    flows.enabled = parse_bool(ini.GetValue("flows", "enabled", "true"));
+    flows.path = ini.GetValue("flows", "path", "");
+    std::string format = ini.GetValue("flows", "format", "auto");
+    if (format == "csv") {
+        flows.format = FlowRecordFormat::Csv;
+    } else if (format == "binary") {
+        flows.format = FlowRecordFormat::Binary;
+    } else {
+        flows.format = FlowRecordFormat::Auto;
+    }
+}
+
+bool ConfigParser::expand_input_paths(const std::string& value,
+                                      std::vector<std::string>& paths) const {
+    paths.clear();
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        // 去除首尾空格
+        size_t start = item.find_first_not_of(" \t\r\n");
+        size_t end = item.find_last_not_of(" \t\r\n");
+        if (start == std::string::npos) {
+            continue;
+        }
+        item = item.substr(start, end - start + 1);
+
+        // 不含通配符的路径原样保留，由读取阶段报告不存在的文件
+        if (item.find_first_of("*?[") == std::string::npos) {
+            paths.push_back(item);
+            continue;
+        }
+        glob_t matches;
+        int rc = ::glob(item.c_str(), 0, nullptr, &matches);
+        if (rc != 0) {
+            std::cerr << "通配符没有匹配的文件: " << item << std::endl;
+            if (rc != GLOB_NOMATCH) {
+                ::globfree(&matches);
+            }
+            return false;
+        }
+        // glob 已按文件名排序
+        for (size_t i = 0; i < matches.gl_pathc; ++i) {
+            paths.push_back(matches.gl_pathv[i]);
+        }
+        ::globfree(&matches);
+    }
+
+    return !paths.empty();
+}
+
 SketchKind ConfigParser::parse_sketch_kind(const std::string& value) const {
     if (value == "CountMin" || value == "countmin") {
         return SketchKind::CountMin;
@@ -168,7 +477,39 @@ SketchKind ConfigParser::parse_sketch_kind(const std::string& value) const {
     return SketchKind::CountSketch;  // 默认值
 }
 
+FlowKeyKind ConfigParser::parse_flow_key_kind(const std::string& value) const {
+    if (value == "five_tuple" || value == "FiveTuple") {
+        return FlowKeyKind::FiveTuple;
+    } else if (value == "ipv6" || value == "IPv6") {
+        return FlowKeyKind::IPv6;
+    }
+    return FlowKeyKind::TwoTuple;  // 默认值
+}
+
 bool ConfigParser::parse_bool(const std::string& value) const {
     return value == "1" || value == "true" || value == "TRUE" ||
            value == "True";
 }
+
+uint32_t ConfigParser::read_count(const CSimpleIniA& ini,
+                                  const char* section,
+                                  const char* key,
+                                  uint32_t default_value,
+                                  uint32_t limit) const {
+    long value = ini.GetLongValue(section, key, default_value);
+    if (value < 0) {
+        std::cerr << key << " 不能为负数，已使用 " << default_value
+                  << std::endl;
+        return default_value;
+    }
+    if (static_cast<unsigned long>(value) > limit) {
+        std::cerr << key << " 超过上限 " << limit << "，已截断为 " << limit
+                  << std::endl;
+        return limit;
+    }
+    return static_cast<uint32_t>(value);
+}
+
+uint32_t ConfigParser::max_threads() {
+    return std::max(1U, std::thread::hardware_concurrency()) * 4;
+}
@@ -1,53 +1,188 @@
 #include "DiSketch.h"
 
+#include "ParallelRun.h"
+
+namespace {
+
+// 每次从 PacketSource 拉取的包数
+constexpr size_t kSourceBatchSize = 4096;
+
+// 按流编号排列的 sketch 键：二元组直接使用字典，更宽的键逐流折叠一次
+const TwoTuple* sketch_key_table(const BasicPacketStore<TwoTuple>& store,
+                                 std::vector<TwoTuple>&) {
+    return &store.flow(0);
+}
+
+template <typename Key>
+const TwoTuple* sketch_key_table(const BasicPacketStore<Key>& store,
+                                 std::vector<TwoTuple>& keys) {
+    keys.resize(store.flow_count());
+    for (size_t id = 0; id < keys.size(); ++id) {
+        keys[id] = FlowKeyTraits<Key>::sketch_key(
+            store.flow(static_cast<uint32_t>(id)));
+    }
+    return keys.data();
+}
+
+}  // namespace
+
 DiSketch::DiSketch(DiSketchConfig config)
-    : config_(std::move(config)), topology_(config_.topology) {}
+    : config_(std::move(config)), topology_(config_.topology) {
+    if (!supports_eval_threads(config_)) {
+        config_.eval_threads = 1;
+    }
+}
+
+bool DiSketch::supports_eval_threads(const DiSketchConfig& config) {
+    if (!sketch_query_is_read_only(config.sketch_kind)) {
+        return false;
+    }
+    for (const auto& fragment : config.topology.fragments) {
+        if (!sketch_query_is_read_only(fragment.kind)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void DiSketch::submit_summary(
+    EpochEvaluator& evaluator,
+    uint64_t epoch,
+    uint64_t epoch_packet_count,
+    Ideal& ideal,
+    std::shared_ptr<Sketch>& full_sketch,
+    uint64_t full_sketch_memory,
+    std::vector<FragmentEpochReport>& fragment_reports) const {
+    auto epoch_ideal = std::make_shared<Ideal>(std::move(ideal));
+    auto reports = std::make_shared<std::vector<FragmentEpochReport>>(
+        std::move(fragment_reports));
+    std::shared_ptr<Sketch> epoch_sketch = full_sketch;
+    if (evaluator.async()) {
+        // 旧实例交给评估任务，下一个 epoch 写入新的 Full Sketch
+        full_sketch = create_full_sketch(full_sketch_memory);
+    }
+    evaluator.submit([this, epoch, epoch_packet_count, epoch_ideal,
+                      epoch_sketch, reports]() {
+        return summarize_epoch(epoch, epoch_packet_count, *epoch_ideal,
+                               epoch_sketch.get(), *reports);
+    });
+}
+
+template <typename Evaluate>
+void DiSketch::evaluate_flows(size_t flow_count,
+                              EpochSummary& summary,
+                              const Evaluate& evaluate) const {
+    // 每个线程至少分到的流数，流太少时线程开销大于收益
+    constexpr size_t kMinFlowsPerThread = 4096;
+    size_t threads = std::min<size_t>(
+        std::max<uint32_t>(1, config_.eval_threads),
+        std::max<size_t>(1, flow_count / kMinFlowsPerThread));
+    if (threads <= 1) {
+        for (size_t i = 0; i < flow_count; ++i) {
+            evaluate(i, summary);
+        }
+        return;
+    }
+
+    std::vector<EpochSummary> parts(threads);
+    run_in_parallel(threads, [&](size_t t) {
+        EpochSummary& part = parts[t];
+        part.heavy_hitter_threshold = summary.heavy_hitter_threshold;
+        size_t begin = flow_count * t / threads;
+        size_t end = flow_count * (t + 1) / threads;
+        for (size_t i = begin; i < end; ++i) {
+            evaluate(i, part);
+        }
+    });
+
+    // 按段的顺序合并，flow_metrics 的顺序与串行遍历相同
+    for (auto& part : parts) {
+        summary.full_sketch_detector.tp += part.full_sketch_detector.tp;
+        summary.full_sketch_detector.tn += part.full_sketch_detector.tn;
+        summary.full_sketch_detector.fp += part.full_sketch_detector.fp;
+        summary.full_sketch_detector.fn += part.full_sketch_detector.fn;
+        summary.disketch_detector.tp += part.disketch_detector.tp;
+        summary.disketch_detector.tn += part.disketch_detector.tn;
+        summary.disketch_detector.fp += part.disketch_detector.fp;
+        summary.disketch_detector.fn += part.disketch_detector.fn;
+        summary.flow_metrics.insert(summary.flow_metrics.end(),
+                                    part.flow_metrics.begin(),
+                                    part.flow_metrics.end());
+    }
+}
 
 DiSketchReport DiSketch::run(const PacketParser::PacketVector& packets) {
+    VectorPacketSource source(packets);
+    return run(source);
+}
+
+DiSketchReport DiSketch::run(PacketSource& source) {
     DiSketchReport report;
-    if (packets.empty()) {
-        progress_bar_.reset();
-        progress_enabled_ = false;
-        return report;
+
+    const PacketRecord* batch = nullptr;
+    size_t batch_size = 0;
+    size_t batch_pos = 0;
+    uint64_t first_ts = 0;
+    // 来源给出时钟起点时从起点划分 epoch，否则从第一个包开始
+    if (!source.start_time(first_ts)) {
+        batch_size = source.next_batch(batch, kSourceBatchSize);
+        if (batch_size == 0) {
+            progress_bar_.reset();
+            progress_enabled_ = false;
+            return report;
+        }
+        first_ts = batch[0].timestamp.count();
     }
 
     uint64_t epoch_duration = std::max<uint64_t>(1, config_.epoch_duration_ns);
-    uint64_t first_ts = packets.front().timestamp.count();
-    uint64_t last_ts = packets.back().timestamp.count();
-    if (last_ts < first_ts) {
-        return report;
+
+    // 时间范围已知时预先算出 epoch 数，否则处理到数据耗尽为止
+    uint64_t bound_first = 0;
+    uint64_t bound_last = 0;
+    bool bounds_known = source.time_bounds(bound_first, bound_last);
+    uint64_t total_epochs = 0;  // 0 表示不限
+    if (bounds_known) {
+        if (bound_last < first_ts) {
+            return report;
+        }
+        total_epochs = (bound_last - first_ts) / epoch_duration + 1;
     }
-    uint64_t total_epochs = (last_ts - first_ts) / epoch_duration + 1;
     if (config_.max_epochs > 0) {
-        total_epochs = std::min<uint64_t>(total_epochs, config_.max_epochs);
+        total_epochs = total_epochs == 0
+                           ? config_.max_epochs
+                           : std::min<uint64_t>(total_epochs, config_.max_epochs);
     }
     init_progress_bar(static_cast<size_t>(total_epochs));
 
     // 准备 fragments
-    std::vector<Fragment> disketch_fragments;
-    disketch_fragments.reserve(config_.topology.fragments.size());
-    for (size_t i = 0; i < config_.topology.fragments.size(); ++i) {
-        disketch_fragments.emplace_back(
-            static_cast<int>(i), config_.topology.fragments[i], epoch_duration);
-    }
+    PacketSampler sampler(config_.sampling);
+    bool sampling = config_.sampling.enabled();
+    std::vector<Fragment> disketch_fragments =
+        create_fragments(epoch_duration, sampler.scale());
+    std::unique_ptr<FragmentWorkerPool> workers =
+        create_workers(disketch_fragments);
 
     // 准备 Full Sketch
     uint64_t full_sketch_memory = 0;
     for (const auto& frag : config_.topology.fragments) {
         full_sketch_memory += frag.memory_bytes;
     }
-    auto full_sketch = create_full_sketch(full_sketch_memory);
+    std::shared_ptr<Sketch> full_sketch =
+        create_full_sketch(full_sketch_memory);
+    EpochEvaluator evaluator(config_.eval_queue);
 
-    // 逐 epoch 处理数据包
-    size_t packet_index = 0;
+    // 逐 epoch 拉取并处理数据包
+    bool exhausted = false;
     size_t epochs_completed = 0;
-    for (uint64_t epoch = 0; epoch < total_epochs; ++epoch) {
+    for (uint64_t epoch = 0; total_epochs == 0 || epoch < total_epochs;
+         ++epoch) {
+        if (!bounds_known && exhausted) {
+            break;
+        }
         uint64_t epoch_start = first_ts + epoch * epoch_duration;
         uint64_t epoch_end = epoch_start + epoch_duration;
 
-        for (auto& frag : disketch_fragments) {
-            frag.begin_epoch(epoch, epoch_start);
-        }
+        begin_fragments(disketch_fragments, workers.get(), epoch, epoch_start);
         if (full_sketch) {
             full_sketch->clear();
         }
@@ -57,11 +192,25 @@ DiSketchReport DiSketch::run(const PacketParser::PacketVector& packets) {
         uint64_t epoch_packet_count = 0;
 
         // 处理一个 epoch
-        while (packet_index < packets.size()) {
-            const auto& pkt = packets[packet_index];
+        while (!exhausted) {
+            if (batch_pos >= batch_size) {
+                // 实时来源在没有流量时按墙钟结束 epoch
+                if (!source.wait_for_data(epoch_end)) {
+                    break;
+                }
+                batch_size = source.next_batch(batch, kSourceBatchSize);
+                batch_pos = 0;
+                if (batch_size == 0) {
+                    exhausted = true;
+                    break;
+                }
+            }
+            const auto& pkt = batch[batch_pos];
             uint64_t ts = pkt.timestamp.count();
             if (ts < epoch_start) {
-                ++packet_index;
+                // 所属 epoch 已经结束，只能丢弃并计数
+                report.late_packets += 1;
+                ++batch_pos;
                 continue;
             }
             if (ts >= epoch_end) {
@@ -72,113 +221,580 @@ DiSketchReport DiSketch::run(const PacketParser::PacketVector& packets) {
             if (full_sketch) {
                 full_sketch->update(pkt.flow, 1);
             }
+            ++batch_pos;
+            // 真实计数与 Full Sketch 不采样，只有被选中的包进入 fragment
+            if (sampling && !sampler.sample(pkt.flow, ts)) {
+                continue;
+            }
             const auto& path = topology_.pick_path(pkt.flow);
+            if (workers) {
+                workers->dispatch(pkt.flow, ts, path);
+                continue;
+            }
             bool single_hop = path.node_indices.size() <= 1;
             for (int node_index : path.node_indices) {
                 disketch_fragments[node_index].process_packet(pkt.flow, ts,
                                                               single_hop);
             }
-            ++packet_index;
         }
 
         // 收集当前 epoch 所有 fragment 的报告
-        std::vector<FragmentEpochReport> fragment_reports;
-        double rho_sum = 0.0;
-        uint32_t rho_count = 0;
+        std::vector<FragmentEpochReport> fragment_reports =
+            close_fragments(disketch_fragments, workers.get());
 
-        for (auto& frag : disketch_fragments) {
-            FragmentEpochReport frag_report = frag.close_epoch();
-            rho_sum += frag_report.rho_average;
-            if (!frag_report.records.empty()) {
-                rho_count += 1;
+        submit_summary(evaluator, epoch, epoch_packet_count, ideal,
+                       full_sketch, full_sketch_memory, fragment_reports);
+
+        epochs_completed += 1;
+        update_progress(epochs_completed);
+    }
+
+    report.epochs = evaluator.finish();
+    return report;
+}
+
+// 在内存 trace 上处理 epoch 的可变状态，epoch 并行时每个线程一份
+struct DiSketch::StoreLane {
+    explicit StoreLane(const SamplingConfig& sampling) : sampler(sampling) {}
+
+    const TwoTuple* sketch_keys = nullptr;  // 按流编号的 sketch 键，各份共享
+    const std::vector<const PathSetting*>* flow_paths = nullptr;  // 各份共享
+    std::vector<Fragment> fragments;
+    std::unique_ptr<FragmentWorkerPool> workers;  // 只在串行执行时使用
+    std::shared_ptr<Sketch> full_sketch;
+    PacketSampler sampler;
+    std::vector<uint64_t> flow_packets;  // 本 epoch 各流的真实包数
+    std::vector<uint32_t> epoch_flows;   // 本 epoch 出现过的流编号
+    std::vector<std::vector<size_t>> subepoch_bounds;
+    std::vector<uint32_t> subepoch_cursor;
+    std::vector<size_t> cuts;
+};
+
+template <typename Key>
+std::vector<FragmentEpochReport> DiSketch::ingest_store_epoch(
+    const BasicPacketStore<Key>& store,
+    uint64_t epoch,
+    StoreLane& lane) const {
+    const uint32_t* flow_ids = store.flow_ids();
+    const uint64_t* timestamps = store.timestamps();
+    const TwoTuple* sketch_keys = lane.sketch_keys;
+    const auto& flow_paths = *lane.flow_paths;
+    std::vector<Fragment>& disketch_fragments = lane.fragments;
+    FragmentWorkerPool* workers = lane.workers.get();
+    Sketch* full_sketch = lane.full_sketch.get();
+    bool sampling = config_.sampling.enabled();
+    size_t fragment_count = disketch_fragments.size();
+    auto& subepoch_bounds = lane.subepoch_bounds;
+    auto& subepoch_cursor = lane.subepoch_cursor;
+    auto& cuts = lane.cuts;
+
+    uint64_t epoch_start = store.epoch_start(epoch);
+    begin_fragments(disketch_fragments, workers, epoch, epoch_start);
+    if (full_sketch) {
+        full_sketch->clear();
+    }
+
+    // 合并所有 fragment 的 subepoch 边界，每段内各 fragment 的 subepoch 固定
+    // 工作线程按时间戳自行定位 subepoch，整个 epoch 只有一段
+    cuts.clear();
+    for (size_t f = 0; !workers && f < fragment_count; ++f) {
+        const Fragment& frag = disketch_fragments[f];
+        store.subepoch_offsets(epoch, frag.subepoch_count(),
+                               frag.subepoch_duration(), subepoch_bounds[f]);
+        subepoch_cursor[f] = 0;
+        cuts.insert(cuts.end(), subepoch_bounds[f].begin(),
+                    subepoch_bounds[f].end());
+    }
+    cuts.push_back(store.epoch_begin(epoch));
+    cuts.push_back(store.epoch_end(epoch));
+    std::sort(cuts.begin(), cuts.end());
+    cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+
+    lane.epoch_flows.clear();
+    for (size_t c = 0; c + 1 < cuts.size(); ++c) {
+        size_t segment_begin = cuts[c];
+        size_t segment_end = cuts[c + 1];
+
+        for (size_t f = 0; !workers && f < fragment_count; ++f) {
+            const auto& bounds = subepoch_bounds[f];
+            uint32_t& cursor = subepoch_cursor[f];
+            while (cursor + 2 < bounds.size() &&
+                   bounds[cursor + 1] <= segment_begin) {
+                ++cursor;
             }
-            fragment_reports.push_back(std::move(frag_report));
+            disketch_fragments[f].advance_to_subepoch(cursor);
         }
 
-        // 整理当前 epoch 报告
-        EpochSummary summary;
-        summary.epoch_id = epoch;
-        summary.rho_average = rho_count == 0 ? 0.0 : rho_sum / rho_count;
-        summary.total_packets = epoch_packet_count;
-        summary.total_flows = ideal.get_flow_count();
-
-        // 记录每个 fragment 的子epoch数量
-        for (const auto& frag_report : fragment_reports) {
-            uint32_t subepoch_count = 0;
-            if (!frag_report.records.empty()) {
-                subepoch_count = frag_report.records[0].total_subepochs;
+        for (size_t i = segment_begin; i < segment_end; ++i) {
+            uint32_t id = flow_ids[i];
+            const TwoTuple& flow = sketch_keys[id];
+            if (lane.flow_packets[id]++ == 0) {
+                lane.epoch_flows.push_back(id);
+            }
+            if (full_sketch) {
+                full_sketch->update(flow, 1);
+            }
+            if (sampling && !lane.sampler.sample(flow, timestamps[i])) {
+                continue;
+            }
+            const auto& path = *flow_paths[id];
+            if (workers) {
+                workers->dispatch(flow, timestamps[i], path);
+                continue;
+            }
+            bool single_hop = path.node_indices.size() <= 1;
+            for (int node_index : path.node_indices) {
+                disketch_fragments[node_index].process_in_subepoch(
+                    id, flow, single_hop);
             }
-            summary.fragment_subepoch_counts.push_back(subepoch_count);
         }
-        double threshold = epoch_packet_count * config_.heavy_hitter_ratio;
-        summary.heavy_hitter_threshold = threshold;
+    }
 
-        // 重置检测器
-        summary.full_sketch_detector.reset();
-        summary.disketch_detector.reset();
+    return close_fragments(disketch_fragments, workers);
+}
 
-        // 遍历所有流,进行三种方法的对比评估
-        const auto& epoch_counts = ideal.get_raw_data();
-        for (const auto& flow_pair : epoch_counts) {
-            const TwoTuple& flow = flow_pair.first;
-            uint64_t packet_count = flow_pair.second;
+std::shared_ptr<DiSketch::EpochCounts> DiSketch::take_epoch_counts(
+    StoreLane& lane) const {
+    auto counts = std::make_shared<EpochCounts>();
+    counts->reserve(lane.epoch_flows.size());
+    for (uint32_t id : lane.epoch_flows) {
+        counts->emplace_back(id, lane.flow_packets[id]);
+        lane.flow_packets[id] = 0;
+    }
+    return counts;
+}
 
-            // 判断是否为真实重流
-            bool is_real_heavy =
-                (threshold <= 0.0 || packet_count >= threshold);
+EpochSummary DiSketch::evaluate_store_epoch(
+    uint64_t epoch,
+    uint64_t epoch_packet_count,
+    const EpochCounts& counts,
+    const TwoTuple* sketch_keys,
+    const std::vector<const PathSetting*>& flow_paths,
+    Sketch* full_sketch,
+    const std::vector<FragmentEpochReport>& fragment_reports) const {
+    EpochSummary summary = begin_summary(epoch, epoch_packet_count,
+                                         counts.size(), fragment_reports);
+    evaluate_flows(counts.size(), summary, [&](size_t i, EpochSummary& part) {
+        uint32_t id = counts[i].first;
+        evaluate_flow(sketch_keys[id], counts[i].second, *flow_paths[id],
+                      full_sketch, fragment_reports, part);
+    });
+    return summary;
+}
 
-            FlowMetric metric;
-            metric.flow = flow;
-            metric.ideal = packet_count;
+template <typename Key>
+void DiSketch::run_epoch_parallel(
+    const BasicPacketStore<Key>& store,
+    uint64_t total_epochs,
+    std::vector<std::unique_ptr<StoreLane>>& lanes,
+    DiSketchReport& report) {
+    size_t fragment_count = lanes[0]->fragments.size();
+    // 下一个待处理的 epoch 开始时各 fragment 的 subepoch 数，由已接受的
+    // epoch 确定
+    std::vector<uint32_t> known(fragment_count);
+    for (size_t f = 0; f < fragment_count; ++f) {
+        known[f] = lanes[0]->fragments[f].subepoch_count();
+    }
+    // 每份状态本轮摄入的结果，验证通过后才评估
+    std::vector<std::vector<FragmentEpochReport>> reports(lanes.size());
+    std::vector<std::shared_ptr<EpochCounts>> counts(lanes.size());
+    std::vector<std::vector<uint32_t>> next_counts(
+        lanes.size(), std::vector<uint32_t>(fragment_count));
+    std::vector<EpochSummary> summaries(lanes.size());
+    uint64_t first_packet = store.epoch_begin(0);
+    ParallelRunner runner(lanes.size());
+
+    uint64_t epoch = 0;
+    while (epoch < total_epochs) {
+        size_t wave = static_cast<size_t>(
+            std::min<uint64_t>(lanes.size(), total_epochs - epoch));
+        // 每一轮的 epoch 都按 known 开始：第一个是确定的，其余预测为不变
+        // 每份状态处理的 epoch 号严格递增，fragment 按流编号的缓存不会误中
+        runner.run(wave, [&](size_t k) {
+            StoreLane& lane = *lanes[k];
+            uint64_t current = epoch + k;
+            for (size_t f = 0; f < fragment_count; ++f) {
+                lane.fragments[f].set_subepoch_count(known[f]);
+            }
+            lane.sampler.seek(store.epoch_begin(current) - first_packet);
 
-            if (full_sketch) {
-                metric.full_sketch = full_sketch->query(flow);
-                // 判断 Full Sketch 是否检测为重流
-                bool detected_by_full = (metric.full_sketch >= threshold);
-
-                // 更新 Full Sketch 检测器的统计
-                if (is_real_heavy && detected_by_full) {
-                    summary.full_sketch_detector.tp++;
-                } else if (is_real_heavy && !detected_by_full) {
-                    summary.full_sketch_detector.fn++;
-                } else if (!is_real_heavy && detected_by_full) {
-                    summary.full_sketch_detector.fp++;
-                } else {
-                    summary.full_sketch_detector.tn++;
-                }
+            reports[k] = ingest_store_epoch(store, current, lane);
+            counts[k] = take_epoch_counts(lane);
+            for (size_t f = 0; f < fragment_count; ++f) {
+                next_counts[k][f] = lane.fragments[f].subepoch_count();
             }
+        });
+
+        // 第 k 个 epoch 的预测成立，当且仅当前一个 epoch 结束后的
+        // subepoch 数仍等于 known；从第一个不成立的 epoch 开始下一轮
+        size_t accepted = 1;
+        while (accepted < wave && next_counts[accepted - 1] == known) {
+            ++accepted;
+        }
+
+        // 只评估接受的 epoch，各自使用本 lane 的 Full Sketch 与报告
+        runner.run(accepted, [&](size_t k) {
+            StoreLane& lane = *lanes[k];
+            uint64_t current = epoch + k;
+            uint64_t epoch_packet_count =
+                store.epoch_end(current) - store.epoch_begin(current);
+            summaries[k] = evaluate_store_epoch(
+                current, epoch_packet_count, *counts[k], lane.sketch_keys,
+                *lane.flow_paths, lane.full_sketch.get(), reports[k]);
+        });
+        for (size_t k = 0; k < accepted; ++k) {
+            report.epochs.push_back(std::move(summaries[k]));
+        }
+        report.epoch_reruns += wave - accepted;
+        known = next_counts[accepted - 1];
+        epoch += accepted;
+        update_progress(static_cast<size_t>(epoch));
+    }
+}
 
-            const auto& path = topology_.pick_path(flow);
-            // 时空聚合: 先在每个 fragment 进行时间聚合,再在路径上进行空间聚合
-            metric.disketch = spatial_aggregation(flow, path, fragment_reports);
-
-            // 判断 DiSketch 是否检测为重流
-            bool detected_by_disketch = (metric.disketch >= threshold);
-
-            // 更新 DiSketch 检测器的统计
-            if (is_real_heavy && detected_by_disketch) {
-                summary.disketch_detector.tp++;
-            } else if (is_real_heavy && !detected_by_disketch) {
-                summary.disketch_detector.fn++;
-            } else if (!is_real_heavy && detected_by_disketch) {
-                summary.disketch_detector.fp++;
-            } else {
-                summary.disketch_detector.tn++;
+template <typename Key>
+DiSketchReport DiSketch::run(const BasicPacketStore<Key>& store) {
+    DiSketchReport report;
+    if (store.empty()) {
+        progress_bar_.reset();
+        progress_enabled_ = false;
+        return report;
+    }
+
+    uint64_t epoch_duration = std::max<uint64_t>(1, config_.epoch_duration_ns);
+    if (store.epoch_duration() != epoch_duration) {
+        throw std::invalid_argument(
+            "PacketStore epoch index does not match epoch_ns");
+    }
+
+    uint64_t total_epochs = store.epoch_count();
+    if (config_.max_epochs > 0) {
+        total_epochs = std::min<uint64_t>(total_epochs, config_.max_epochs);
+    }
+    init_progress_bar(static_cast<size_t>(total_epochs));
+
+    uint64_t full_sketch_memory = 0;
+    for (const auto& frag : config_.topology.fragments) {
+        full_sketch_memory += frag.memory_bytes;
+    }
+
+    // 逐流状态按流编号保存在数组中：路径只选一次，真实计数不再经过哈希表
+    size_t flow_count = store.flow_count();
+    std::vector<TwoTuple> folded_keys;
+    const TwoTuple* sketch_keys = sketch_key_table(store, folded_keys);
+    std::vector<const PathSetting*> flow_paths(flow_count);
+    for (size_t id = 0; id < flow_count; ++id) {
+        flow_paths[id] = &topology_.pick_path(sketch_keys[id]);
+    }
+
+    // epoch 并行时每个线程一份可变状态，串行时只有一份
+    size_t lane_count = static_cast<size_t>(std::max<uint64_t>(
+        1, std::min<uint64_t>(config_.epoch_threads, total_epochs)));
+    std::vector<std::unique_ptr<StoreLane>> lanes;
+    for (size_t l = 0; l < lane_count; ++l) {
+        auto lane = std::make_unique<StoreLane>(config_.sampling);
+        lane->sketch_keys = sketch_keys;
+        lane->flow_paths = &flow_paths;
+        lane->fragments =
+            create_fragments(epoch_duration, lane->sampler.scale());
+        for (auto& frag : lane->fragments) {
+            frag.reserve_flow_ids(flow_count);
+        }
+        lane->full_sketch = create_full_sketch(full_sketch_memory);
+        lane->flow_packets.assign(flow_count, 0);
+        lane->subepoch_bounds.resize(lane->fragments.size());
+        lane->subepoch_cursor.resize(lane->fragments.size());
+        lanes.push_back(std::move(lane));
+    }
+    if (lane_count > 1) {
+        run_epoch_parallel(store, total_epochs, lanes, report);
+        return report;
+    }
+
+    StoreLane& lane = *lanes[0];
+    lane.workers = create_workers(lane.fragments);
+    // 评估任务引用上面的流表，必须在它们之后构造、之前析构
+    EpochEvaluator evaluator(config_.eval_queue);
+
+    for (uint64_t epoch = 0; epoch < total_epochs; ++epoch) {
+        auto reports = std::make_shared<std::vector<FragmentEpochReport>>(
+            ingest_store_epoch(store, epoch, lane));
+        uint64_t epoch_packet_count =
+            store.epoch_end(epoch) - store.epoch_begin(epoch);
+
+        // 取出本 epoch 各流的包数后即可清零，供下一个 epoch 累加
+        std::shared_ptr<EpochCounts> epoch_counts = take_epoch_counts(lane);
+        std::shared_ptr<Sketch> epoch_sketch = lane.full_sketch;
+        if (evaluator.async()) {
+            // 旧实例交给评估任务，下一个 epoch 写入新的 Full Sketch
+            lane.full_sketch = create_full_sketch(full_sketch_memory);
+        }
+        evaluator.submit([this, epoch, epoch_packet_count, epoch_counts,
+                          reports, epoch_sketch, sketch_keys, &flow_paths]() {
+            return evaluate_store_epoch(epoch, epoch_packet_count,
+                                        *epoch_counts, sketch_keys, flow_paths,
+                                        epoch_sketch.get(), *reports);
+        });
+        update_progress(static_cast<size_t>(epoch + 1));
+    }
+
+    report.epochs = evaluator.finish();
+    return report;
+}
+
+template DiSketchReport DiSketch::run(const BasicPacketStore<TwoTuple>&);
+template DiSketchReport DiSketch::run(const BasicPacketStore<FiveTuple>&);
+template DiSketchReport DiSketch::run(const BasicPacketStore<IPv6TwoTuple>&);
+
+DiSketchReport DiSketch::run(const std::vector<FlowRecord>& records) {
+    DiSketchReport report;
+    if (records.empty()) {
+        progress_bar_.reset();
+        progress_enabled_ = false;
+        return report;
+    }
+
+    uint64_t epoch_duration = std::max<uint64_t>(1, config_.epoch_duration_ns);
+    uint64_t first_ts = records.front().start_ns;
+    uint64_t last_ts = first_ts;
+    for (const auto& record : records) {
+        last_ts = std::max(last_ts, record.end_ns);
+    }
+    uint64_t total_epochs = (last_ts - first_ts) / epoch_duration + 1;
+    if (config_.max_epochs > 0) {
+        total_epochs = std::min<uint64_t>(total_epochs, config_.max_epochs);
+    }
+    init_progress_bar(static_cast<size_t>(total_epochs));
+
+    // 流记录已经是聚合结果，不做包采样
+    std::vector<Fragment> disketch_fragments =
+        create_fragments(epoch_duration, 1);
+
+    uint64_t full_sketch_memory = 0;
+    for (const auto& frag : config_.topology.fragments) {
+        full_sketch_memory += frag.memory_bytes;
+    }
+    std::shared_ptr<Sketch> full_sketch =
+        create_full_sketch(full_sketch_memory);
+    EpochEvaluator evaluator(config_.eval_queue);
+
+    // 与当前 epoch 有交集的记录，路径在记录开始时选定一次
+    struct ActiveRecord {
+        const FlowRecord* record;
+        const PathSetting* path;
+    };
+    std::vector<ActiveRecord> active;
+    size_t next_record = 0;
+    size_t fragment_count = disketch_fragments.size();
+    // 每个 fragment 需要处理的活跃记录下标
+    std::vector<std::vector<uint32_t>> fragment_records(fragment_count);
+
+    for (uint64_t epoch = 0; epoch < total_epochs; ++epoch) {
+        uint64_t epoch_start = first_ts + epoch * epoch_duration;
+        uint64_t epoch_end = epoch_start + epoch_duration;
+
+        for (auto& frag : disketch_fragments) {
+            frag.begin_epoch(epoch, epoch_start);
+        }
+        if (full_sketch) {
+            full_sketch->clear();
+        }
+
+        while (next_record < records.size() &&
+               records[next_record].start_ns < epoch_end) {
+            const FlowRecord& record = records[next_record++];
+            active.push_back({&record, &topology_.pick_path(record.flow)});
+        }
+        for (auto& list : fragment_records) {
+            list.clear();
+        }
+        for (size_t i = 0; i < active.size(); ++i) {
+            for (int node_index : active[i].path->node_indices) {
+                fragment_records[node_index].push_back(
+                    static_cast<uint32_t>(i));
+            }
+        }
+
+        // 真实计数与 Full Sketch 按整个 epoch 内的包数更新
+        Ideal ideal;
+        ideal.clear();
+        uint64_t epoch_packet_count = 0;
+        for (const auto& entry : active) {
+            uint64_t count =
+                entry.record->packets_between(epoch_start, epoch_end);
+            if (count == 0) {
+                continue;
+            }
+            epoch_packet_count += count;
+            update_weighted(ideal, entry.record->flow, count);
+            if (full_sketch) {
+                update_weighted(*full_sketch, entry.record->flow, count);
             }
+        }
 
-            if (threshold <= 0.0 || metric.ideal >= threshold) {
-                summary.flow_metrics.push_back(metric);
+        // 各 fragment 按自己的 subepoch 划分，逐段计入记录落在段内的包数
+        for (size_t f = 0; f < fragment_count; ++f) {
+            Fragment& frag = disketch_fragments[f];
+            uint32_t subepochs = frag.subepoch_count();
+            uint64_t duration = frag.subepoch_duration();
+            for (uint32_t s = 0; s < subepochs; ++s) {
+                uint64_t begin = epoch_start + s * duration;
+                // 最后一个 subepoch 延伸到 epoch 结束，与逐包处理一致
+                uint64_t end =
+                    s + 1 == subepochs ? epoch_end : begin + duration;
+                frag.advance_to_subepoch(s);
+                for (uint32_t i : fragment_records[f]) {
+                    const ActiveRecord& entry = active[i];
+                    uint64_t count = entry.record->packets_between(begin, end);
+                    bool single_hop = entry.path->node_indices.size() <= 1;
+                    frag.process_weighted_in_subepoch(entry.record->flow,
+                                                      count, single_hop);
+                }
             }
         }
-        report.epochs.push_back(std::move(summary));
 
-        epochs_completed += 1;
-        update_progress(epochs_completed);
+        std::vector<FragmentEpochReport> fragment_reports;
+        fragment_reports.reserve(fragment_count);
+        for (auto& frag : disketch_fragments) {
+            fragment_reports.push_back(frag.close_epoch());
+        }
+
+        submit_summary(evaluator, epoch, epoch_packet_count, ideal,
+                       full_sketch, full_sketch_memory, fragment_reports);
+
+        // 在本 epoch 内结束的记录不再参与后续 epoch
+        active.erase(std::remove_if(active.begin(), active.end(),
+                                    [epoch_end](const ActiveRecord& entry) {
+                                        return entry.record->end_ns < epoch_end;
+                                    }),
+                     active.end());
+        update_progress(static_cast<size_t>(epoch + 1));
     }
 
+    report.epochs = evaluator.finish();
     return report;
 }
 
+EpochSummary DiSketch::summarize_epoch(
+    uint64_t epoch,
+    uint64_t epoch_packet_count,
+    Ideal& ideal,
+    Sketch* full_sketch,
+    const std::vector<FragmentEpochReport>& fragment_reports) const {
+    EpochSummary summary = begin_summary(
+        epoch, epoch_packet_count, ideal.get_flow_count(), fragment_reports);
+
+    // 遍历所有流,进行三种方法的对比评估
+    // 哈希表不能按下标切分，先按遍历顺序取出各项
+    const auto& epoch_counts = ideal.get_raw_data();
+    std::vector<const std::pair<const TwoTuple, uint64_t>*> flows;
+    flows.reserve(epoch_counts.size());
+    for (const auto& flow_pair : epoch_counts) {
+        flows.push_back(&flow_pair);
+    }
+    evaluate_flows(flows.size(), summary, [&](size_t i, EpochSummary& part) {
+        const auto& flow_pair = *flows[i];
+        evaluate_flow(flow_pair.first, flow_pair.second,
+                      topology_.pick_path(flow_pair.first), full_sketch,
+                      fragment_reports, part);
+    });
+
+    return summary;
+}
+
+EpochSummary DiSketch::begin_summary(
+    uint64_t epoch,
+    uint64_t epoch_packet_count,
+    uint64_t epoch_flow_count,
+    const std::vector<FragmentEpochReport>& fragment_reports) const {
+    double rho_sum = 0.0;
+    uint32_t rho_count = 0;
+    for (const auto& frag_report : fragment_reports) {
+        rho_sum += frag_report.rho_average;
+        if (!frag_report.records.empty()) {
+            rho_count += 1;
+        }
+    }
+
+    // 整理当前 epoch 报告
+    EpochSummary summary;
+    summary.epoch_id = epoch;
+    summary.rho_average = rho_count == 0 ? 0.0 : rho_sum / rho_count;
+    summary.total_packets = epoch_packet_count;
+    summary.total_flows = epoch_flow_count;
+
+    // 记录每个 fragment 的子epoch数量
+    for (const auto& frag_report : fragment_reports) {
+        uint32_t subepoch_count = 0;
+        if (!frag_report.records.empty()) {
+            subepoch_count = frag_report.records[0].total_subepochs;
+        }
+        summary.fragment_subepoch_counts.push_back(subepoch_count);
+    }
+    summary.heavy_hitter_threshold =
+        epoch_packet_count * config_.heavy_hitter_ratio;
+
+    // 重置检测器
+    summary.full_sketch_detector.reset();
+    summary.disketch_detector.reset();
+    return summary;
+}
+
+void DiSketch::evaluate_flow(
+    const TwoTuple& flow,
+    uint64_t packet_count,
+    const PathSetting& path,
+    Sketch* full_sketch,
+    const std::vector<FragmentEpochReport>& fragment_reports,
+    EpochSummary& summary) const {
+    double threshold = summary.heavy_hitter_threshold;
+
+    // 判断是否为真实重流
+    bool is_real_heavy = (threshold <= 0.0 || packet_count >= threshold);
+
+    FlowMetric metric;
+    metric.flow = flow;
+    metric.ideal = packet_count;
+
+    if (full_sketch) {
+        metric.full_sketch = full_sketch->query(flow);
+        // 判断 Full Sketch 是否检测为重流
+        bool detected_by_full = (metric.full_sketch >= threshold);
+
+        // 更新 Full Sketch 检测器的统计
+        if (is_real_heavy && detected_by_full) {
+            summary.full_sketch_detector.tp++;
+        } else if (is_real_heavy && !detected_by_full) {
+            summary.full_sketch_detector.fn++;
+        } else if (!is_real_heavy && detected_by_full) {
+            summary.full_sketch_detector.fp++;
+        } else {
+            summary.full_sketch_detector.tn++;
+        }
+    }
+
+    // 时空聚合: 先在每个 fragment 进行时间聚合,再在路径上进行空间聚合
+    metric.disketch = spatial_aggregation(flow, path, fragment_reports);
+
+    // 判断 DiSketch 是否检测为重流
+    bool detected_by_disketch = (metric.disketch >= threshold);
+
+    // 更新 DiSketch 检测器的统计
+    if (is_real_heavy && detected_by_disketch) {
+        summary.disketch_detector.tp++;
+    } else if (is_real_heavy && !detected_by_disketch) {
+        summary.disketch_detector.fn++;
+    } else if (!is_real_heavy && detected_by_disketch) {
+        summary.disketch_detector.fp++;
+    } else {
+        summary.disketch_detector.tn++;
+    }
+
+    if (threshold <= 0.0 || metric.ideal >= threshold) {
+        summary.flow_metrics.push_back(metric);
+    }
+}
+
 void DiSketch::init_progress_bar(size_t total_epochs) {
     total_epochs_ = total_epochs;
     if (!config_.enable_progress_bar || total_epochs_ == 0) {
@@ -248,6 +864,55 @@ void DiSketch::update_progress(size_t completed_epochs) {
     progress_bar_->set_progress(completed_epochs);
 }
 
+std::vector<Fragment> DiSketch::create_fragments(
+    uint64_t epoch_duration,
+    uint32_t sampling_rate) const {
+    std::vector<Fragment> fragments;
+    fragments.reserve(config_.topology.fragments.size());
+    for (size_t i = 0; i < config_.topology.fragments.size(); ++i) {
+        FragmentSetting setting = config_.topology.fragments[i];
+        setting.sampling_rate = sampling_rate;
+        fragments.emplace_back(static_cast<int>(i), setting, epoch_duration);
+    }
+    return fragments;
+}
+
+std::unique_ptr<FragmentWorkerPool> DiSketch::create_workers(
+    std::vector<Fragment>& fragments) const {
+    if (config_.fragment_threads <= 1 || fragments.size() <= 1) {
+        return nullptr;
+    }
+    return std::unique_ptr<FragmentWorkerPool>(new FragmentWorkerPool(
+        fragments, topology_.paths(), config_.fragment_threads));
+}
+
+void DiSketch::begin_fragments(std::vector<Fragment>& fragments,
+                               FragmentWorkerPool* workers,
+                               uint64_t epoch,
+                               uint64_t epoch_start) const {
+    if (workers != nullptr) {
+        workers->begin_epoch(epoch, epoch_start);
+        return;
+    }
+    for (auto& frag : fragments) {
+        frag.begin_epoch(epoch, epoch_start);
+    }
+}
+
+std::vector<FragmentEpochReport> DiSketch::close_fragments(
+    std::vector<Fragment>& fragments,
+    FragmentWorkerPool* workers) const {
+    if (workers != nullptr) {
+        return workers->close_epoch();
+    }
+    std::vector<FragmentEpochReport> reports;
+    reports.reserve(fragments.size());
+    for (auto& frag : fragments) {
+        reports.push_back(frag.close_epoch());
+    }
+    return reports;
+}
+
 std::unique_ptr<Sketch> DiSketch::create_full_sketch(
     uint64_t memory_bytes) const {
     if (memory_bytes == 0) {
@@ -291,7 +956,7 @@ uint64_t DiSketch::spatial_aggregation(
             continue;
         }
 
-        // 获得 Fragment 的时间聚合
+        // 获得 Fragment 的时间聚合，已按子 epoch 数与采样率还原为全量估计
         bool boost_single_hop =
             config_.topology.fragments[node_index].boost_single_hop;
         uint64_t value = Fragment::temporal_aggregation(
@@ -0,0 +1,78 @@
+#include "EpochEvaluator.h"
+
+EpochEvaluator::EpochEvaluator(size_t depth)
+    : depth_(depth < kMaxDepth ? depth : kMaxDepth), ring_(depth_ + 1) {
+    if (depth_ > 0) {
+        thread_ = std::thread(&EpochEvaluator::work, this);
+    }
+}
+
+EpochEvaluator::~EpochEvaluator() {
+    if (thread_.joinable()) {
+        cancelled_.store(true, std::memory_order_relaxed);
+        push(Job());
+        thread_.join();
+    }
+}
+
+void EpochEvaluator::push(Job job) {
+    // 结束标记之外最多 depth 个任务，队列容量 depth + 1，消费者总会腾出槽位
+    Job* slot = ring_.wait_acquire([]() { return false; });
+    *slot = std::move(job);
+    ring_.publish();
+}
+
+void EpochEvaluator::submit(Job job) {
+    if (depth_ == 0) {
+        summaries_.push_back(job());
+        return;
+    }
+    if (failed_.load(std::memory_order_acquire)) {
+        std::rethrow_exception(error_);
+    }
+    // 已有 depth 个 epoch 未评估完时等待后台线程
+    drained_.wait([this]() {
+        return pending_.load(std::memory_order_acquire) < depth_;
+    });
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    push(std::move(job));
+}
+
+std::vector<EpochSummary> EpochEvaluator::finish() {
+    if (thread_.joinable()) {
+        push(Job());
+        thread_.join();
+    }
+    if (failed_.load(std::memory_order_acquire)) {
+        std::rethrow_exception(error_);
+    }
+    return std::move(summaries_);
+}
+
+void EpochEvaluator::work() {
+    while (true) {
+        Job* slot = ring_.wait_front([]() { return false; });
+        // 取出任务后立即归还槽位，评估期间分发线程可以继续提交
+        Job job = std::move(*slot);
+        *slot = nullptr;
+        ring_.release();
+        if (!job) {
+            return;
+        }
+
+        // 出错后继续消费队列，避免提交方阻塞，错误在 submit/finish 中报告
+        if (!failed_.load(std::memory_order_relaxed) &&
+            !cancelled_.load(std::memory_order_relaxed)) {
+            try {
+                summaries_.push_back(job());
+            } catch (...) {
+                error_ = std::current_exception();
+                failed_.store(true, std::memory_order_release);
+            }
+        }
+        // 任务持有的状态在这里释放，之后才允许提交新的 epoch
+        job = nullptr;
+        pending_.fetch_sub(1, std::memory_order_release);
+        drained_.notify();
+    }
+}
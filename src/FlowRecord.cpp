@@ -0,0 +1,293 @@
+#include "FlowRecord.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "MappedFile.h"
+
+namespace {
+
+const char kFlowMagic[8] = {'D', 'S', 'K', 'F', 'L', 'O', 'W', 'S'};
+const uint32_t kFlowVersion = 1;
+
+// 时间戳早于 t 的包数
+uint64_t packets_before(const FlowRecord& record, uint64_t t) {
+    if (t <= record.start_ns) {
+        return 0;
+    }
+    if (t > record.end_ns) {
+        return record.packets;
+    }
+    // ceil(packets * (t - start) / (end - start + 1))，乘积可能超过 64 位
+    unsigned __int128 span = record.end_ns - record.start_ns + 1;
+    unsigned __int128 scaled =
+        static_cast<unsigned __int128>(record.packets) * (t - record.start_ns);
+    return static_cast<uint64_t>((scaled + span - 1) / span);
+}
+
+std::runtime_error csv_error(const std::string& path,
+                             size_t line_number,
+                             const std::string& what) {
+    return std::runtime_error(path + ":" + std::to_string(line_number) + ": " +
+                              what);
+}
+
+// 读取一个逗号分隔的无符号整数字段，cursor 移到下一字段开头
+bool parse_number(const char*& cursor, uint64_t& value) {
+    while (*cursor == ' ' || *cursor == '\t') {
+        ++cursor;
+    }
+    if (*cursor < '0' || *cursor > '9') {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtoull(cursor, &end, 10);
+    if (errno == ERANGE) {
+        return false;
+    }
+    cursor = end;
+    while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r') {
+        ++cursor;
+    }
+    if (*cursor == ',') {
+        ++cursor;
+    } else if (*cursor != '\0') {
+        return false;
+    }
+    return true;
+}
+
+// 读取整数形式的 IPv4 地址字段
+bool parse_integer_ip(const char*& cursor, uint32_t& ip) {
+    uint64_t value = 0;
+    if (!parse_number(cursor, value) || value > 0xFFFFFFFFULL) {
+        return false;
+    }
+    ip = static_cast<uint32_t>(value);
+    return true;
+}
+
+// 读取点分十进制形式的 IPv4 地址字段
+bool parse_dotted_ip(const char*& cursor, uint32_t& ip) {
+    while (*cursor == ' ' || *cursor == '\t') {
+        ++cursor;
+    }
+    uint32_t result = 0;
+    for (int octet_index = 0; octet_index < 4; ++octet_index) {
+        if (*cursor < '0' || *cursor > '9') {
+            return false;
+        }
+        uint32_t octet = 0;
+        int digits = 0;
+        while (*cursor >= '0' && *cursor <= '9' && digits < 4) {
+            octet = octet * 10 + static_cast<uint32_t>(*cursor - '0');
+            ++cursor;
+            ++digits;
+        }
+        if (octet > 255) {
+            return false;
+        }
+        result = (result << 8) | octet;
+        if (octet_index < 3 && *cursor++ != '.') {
+            return false;
+        }
+    }
+    while (*cursor == ' ' || *cursor == '\t') {
+        ++cursor;
+    }
+    if (*cursor != ',') {
+        return false;
+    }
+    ++cursor;
+    ip = result;
+    return true;
+}
+
+// 字段中在逗号之前出现 '.' 时按点分十进制解析
+bool parse_address(const char*& cursor, uint32_t& ip) {
+    const char* comma = std::strchr(cursor, ',');
+    const char* dot = std::strchr(cursor, '.');
+    if (dot != nullptr && (comma == nullptr || dot < comma)) {
+        return parse_dotted_ip(cursor, ip);
+    }
+    return parse_integer_ip(cursor, ip);
+}
+
+std::vector<FlowRecord> read_csv(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Failed to open flow record file " + path);
+    }
+    std::vector<FlowRecord> records;
+    std::string line;
+    size_t line_number = 0;
+    bool first_line = true;
+    while (std::getline(in, line)) {
+        line_number += 1;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        bool header = first_line && (line[first] < '0' || line[first] > '9');
+        first_line = false;
+        if (header) {
+            continue;
+        }
+
+        const char* cursor = line.c_str() + first;
+        FlowRecord record;
+        if (!parse_address(cursor, record.flow.src_ip) ||
+            !parse_address(cursor, record.flow.dst_ip)) {
+            throw csv_error(path, line_number, "invalid IPv4 address");
+        }
+        if (!parse_number(cursor, record.start_ns) ||
+            !parse_number(cursor, record.end_ns) ||
+            !parse_number(cursor, record.packets)) {
+            throw csv_error(path, line_number,
+                            "expected start_ns,end_ns,packets");
+        }
+        // bytes 可省略
+        if (*cursor != '\0' && !parse_number(cursor, record.bytes)) {
+            throw csv_error(path, line_number, "invalid bytes field");
+        }
+        if (*cursor != '\0') {
+            throw csv_error(path, line_number, "too many fields");
+        }
+        if (record.end_ns < record.start_ns) {
+            throw csv_error(path, line_number, "end_ns is before start_ns");
+        }
+        records.push_back(record);
+    }
+    return records;
+}
+
+std::vector<FlowRecord> read_binary(const std::string& path) {
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(FlowRecordFileHeader)) {
+        throw std::runtime_error("Failed to open flow record file " + path);
+    }
+    FlowRecordFileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, kFlowMagic, sizeof(kFlowMagic)) != 0 ||
+        header.version != kFlowVersion ||
+        header.record_size != sizeof(FlowRecordFileEntry)) {
+        throw std::runtime_error("Unsupported flow record file " + path);
+    }
+    size_t available =
+        (file.size() - sizeof(header)) / sizeof(FlowRecordFileEntry);
+    if (header.record_count > available) {
+        throw std::runtime_error("Truncated flow record file " + path);
+    }
+
+    std::vector<FlowRecord> records(static_cast<size_t>(header.record_count));
+    const uint8_t* cursor = file.data() + sizeof(header);
+    for (auto& record : records) {
+        FlowRecordFileEntry entry;
+        std::memcpy(&entry, cursor, sizeof(entry));
+        cursor += sizeof(entry);
+        if (entry.end_ns < entry.start_ns) {
+            throw std::runtime_error("Flow record ends before it starts in " +
+                                     path);
+        }
+        record.flow = TwoTuple(entry.src_ip, entry.dst_ip);
+        record.start_ns = entry.start_ns;
+        record.end_ns = entry.end_ns;
+        record.packets = entry.packets;
+        record.bytes = entry.bytes;
+    }
+    return records;
+}
+
+}  // namespace
+
+uint64_t FlowRecord::packets_between(uint64_t begin_ns, uint64_t end_ns) const {
+    if (begin_ns >= end_ns) {
+        return 0;
+    }
+    return packets_before(*this, end_ns) - packets_before(*this, begin_ns);
+}
+
+FlowRecordFormat detect_flow_record_format(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(kFlowMagic)] = {};
+    if (in.read(magic, sizeof(magic)) &&
+        std::memcmp(magic, kFlowMagic, sizeof(kFlowMagic)) == 0) {
+        return FlowRecordFormat::Binary;
+    }
+    return FlowRecordFormat::Csv;
+}
+
+std::vector<FlowRecord> read_flow_records(const std::string& path,
+                                          FlowRecordFormat format) {
+    if (format == FlowRecordFormat::Auto) {
+        format = detect_flow_record_format(path);
+    }
+    return format == FlowRecordFormat::Binary ? read_binary(path)
+                                              : read_csv(path);
+}
+
+std::vector<FlowRecord> load_flow_records(const std::vector<std::string>& paths,
+                                          FlowRecordFormat format) {
+    std::vector<FlowRecord> records;
+    for (const auto& path : paths) {
+        std::vector<FlowRecord> part = read_flow_records(path, format);
+        records.reserve(records.size() + part.size());
+        for (const auto& record : part) {
+            if (record.packets > 0) {
+                records.push_back(record);
+            }
+        }
+    }
+    auto earlier = [](const FlowRecord& a, const FlowRecord& b) {
+        return a.start_ns < b.start_ns;
+    };
+    if (!std::is_sorted(records.begin(), records.end(), earlier)) {
+        std::stable_sort(records.begin(), records.end(), earlier);
+    }
+    return records;
+}
+
+bool write_flow_records(const std::string& path,
+                        const std::vector<FlowRecord>& records) {
+    FlowRecordFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kFlowMagic, sizeof(kFlowMagic));
+    header.version = kFlowVersion;
+    header.record_size = sizeof(FlowRecordFileEntry);
+    header.record_count = records.size();
+
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& record : records) {
+            FlowRecordFileEntry entry;
+            entry.src_ip = record.flow.src_ip;
+            entry.dst_ip = record.flow.dst_ip;
+            entry.start_ns = record.start_ns;
+            entry.end_ns = record.end_ns;
+            entry.packets = record.packets;
+            entry.bytes = record.bytes;
+            out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        }
+        if (!out) {
+            out.close();
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
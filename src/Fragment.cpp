@@ -1,5 +1,51 @@
 #include "Fragment.h"
 
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+// 分片写入时每个分片一批处理的更新数
+constexpr size_t kShardBlockUpdates = 32 * 1024;
+// 每段少于该更新数时减少分片，线程开销大于收益
+constexpr size_t kMinShardUpdates = 4096;
+
+// SketchLib 的线性 sketch 提供 merge(other) 时为 true，合并即逐计数器相加
+template <typename SketchType, typename = void>
+struct HasMerge : std::false_type {};
+
+template <typename SketchType>
+struct HasMerge<SketchType,
+                decltype(std::declval<SketchType&>().merge(
+                    std::declval<const SketchType&>()))> : std::true_type {};
+
+template <typename SketchType>
+void merge_into(Sketch& dst, const Sketch& src, std::true_type) {
+    static_cast<SketchType&>(dst).merge(static_cast<const SketchType&>(src));
+}
+
+template <typename SketchType>
+void merge_into(Sketch&, const Sketch&, std::false_type) {
+    throw std::logic_error("SketchLib 未提供 merge，不能分片写入");
+}
+
+// 把 src 合并到 dst 上，两者种类与维度相同
+void merge_sketch(SketchKind kind, Sketch& dst, const Sketch& src) {
+    switch (kind) {
+        case SketchKind::CountMin:
+            merge_into<CountMin>(dst, src, HasMerge<CountMin>());
+            return;
+        case SketchKind::CountSketch:
+            merge_into<CountSketch>(dst, src, HasMerge<CountSketch>());
+            return;
+        default:
+            throw std::logic_error("非线性 sketch 不能合并");
+    }
+}
+
+}  // namespace
+
 Fragment::Fragment(int index,
                    const FragmentSetting& setting,
                    uint64_t epoch_duration_ns)
@@ -10,6 +56,26 @@ Fragment::Fragment(int index,
       current_rho_(0.0),
       hash_func_(std::make_unique<DefaultHashFunction>()) {
     sketch_ = create_sketch();
+    if (setting_.ingest_shards > 1) {
+        if (!supports_ingest_shards(setting_.kind)) {
+            throw std::invalid_argument(
+                "fragment " + setting_.name +
+                ": ingest_shards > 1 需要可合并的线性 sketch");
+        }
+        shard_count_ = setting_.ingest_shards;
+        shard_runner_ = std::make_unique<ParallelRunner>(shard_count_);
+    }
+}
+
+bool Fragment::supports_ingest_shards(SketchKind kind) {
+    switch (kind) {
+        case SketchKind::CountMin:
+            return HasMerge<CountMin>::value;
+        case SketchKind::CountSketch:
+            return HasMerge<CountSketch>::value;
+        default:
+            return false;
+    }
 }
 
 std::unique_ptr<Sketch> Fragment::create_sketch() const {
@@ -50,6 +116,7 @@ void Fragment::begin_epoch(uint64_t epoch_id, uint64_t epoch_start_ns) {
     packet_counter_ = 0;
     current_rho_ = 0.0;
     emitted_records_.clear();
+    pending_.clear();
     // 每个 seed 都由 fragment_index 和 epoch_id 唯一确定
     hash_seed_ = (static_cast<uint64_t>(index_) << 32) | epoch_id;
     sketch_ = create_sketch();
@@ -66,16 +133,30 @@ void Fragment::process_packet(const TwoTuple& flow,
     uint64_t delta = packet_time_ns - epoch_start_ns_;
     uint32_t subepoch_index = static_cast<uint32_t>(
         std::min<uint64_t>(delta / subepoch_duration_, subepoch_count_ - 1));
+    advance_to_subepoch(subepoch_index);
+    track_packet(flow, subepoch_index, single_hop);
+}
+
+void Fragment::advance_to_subepoch(uint32_t subepoch_index) {
     if (subepoch_index > current_subepoch_) {
         flush_until(subepoch_index);
     }
+}
+
+void Fragment::process_in_subepoch(const TwoTuple& flow, bool single_hop) {
+    track_packet(flow, current_subepoch_, single_hop);
+}
+
+void Fragment::track_packet(const TwoTuple& flow,
+                            uint32_t subepoch_index,
+                            bool single_hop) {
     if (!should_track(flow, hash_seed_, subepoch_index, subepoch_count_,
                       single_hop, setting_.boost_single_hop)) {
         return;
     }
 
     // 更新 sketch 并增量更新 current_rho_
-    update_sketch_and_rho(flow);
+    update_sketch_and_rho(flow, 1);
 
     packet_counter_ += 1;
 }
@@ -102,6 +183,7 @@ FragmentEpochReport Fragment::close_epoch() {
 }
 
 void Fragment::flush_current() {
+    apply_pending();
     if (packet_counter_ == 0) {
         return;
     }
@@ -111,6 +193,7 @@ void Fragment::flush_current() {
     record.epoch_id = epoch_id_;
     record.subepoch_id = current_subepoch_;
     record.total_subepochs = subepoch_count_;
+    record.sampling_rate = setting_.sampling_rate;
     record.kind = setting_.kind;
     record.hash_seed = hash_seed_;
     record.packet_count = packet_counter_;
@@ -130,15 +213,69 @@ void Fragment::flush_until(uint32_t target_subepoch) {
     }
 }
 
+void Fragment::process_in_subepoch(uint32_t flow_id,
+                                   const TwoTuple& flow,
+                                   bool single_hop) {
+    // 同一 epoch 内流的分配结果不变，按编号缓存，避免重复哈希
+    uint64_t& entry = assignment_cache_[flow_id];
+    uint32_t stamp = static_cast<uint32_t>(epoch_id_) + 1;
+    if (static_cast<uint32_t>(entry >> 32) != stamp) {
+        entry = (static_cast<uint64_t>(stamp) << 32) |
+                assigned_subepoch(flow, hash_seed_, subepoch_count_);
+    }
+    if (!subepoch_matches(static_cast<uint32_t>(entry), current_subepoch_,
+                          subepoch_count_, single_hop,
+                          setting_.boost_single_hop)) {
+        return;
+    }
+
+    update_sketch_and_rho(flow, 1);
+
+    packet_counter_ += 1;
+}
+
+void Fragment::process_weighted_in_subepoch(const TwoTuple& flow,
+                                            uint64_t count,
+                                            bool single_hop) {
+    if (count == 0 ||
+        !should_track(flow, hash_seed_, current_subepoch_, subepoch_count_,
+                      single_hop, setting_.boost_single_hop)) {
+        return;
+    }
+
+    update_sketch_and_rho(flow, count);
+
+    packet_counter_ += count;
+}
+
+void Fragment::reserve_flow_ids(size_t flow_count) {
+    assignment_cache_.assign(flow_count, 0);
+}
+
+uint32_t Fragment::assigned_subepoch(const TwoTuple& flow,
+                                     uint64_t hash_seed,
+                                     uint32_t total_subepochs) {
+    DefaultHashFunction hash_func;
+    return static_cast<uint32_t>(
+        hash_func.hash(flow, hash_seed, total_subepochs));
+}
+
 bool Fragment::should_track(const TwoTuple& flow,
                             uint64_t hash_seed,
                             uint32_t subepoch_id,
                             uint32_t total_subepochs,
                             bool single_hop,
                             bool boost_single_hop) {
-    DefaultHashFunction hash_func;
-    uint32_t assigned =
-        static_cast<uint32_t>(hash_func.hash(flow, hash_seed, total_subepochs));
+    return subepoch_matches(assigned_subepoch(flow, hash_seed, total_subepochs),
+                            subepoch_id, total_subepochs, single_hop,
+                            boost_single_hop);
+}
+
+bool Fragment::subepoch_matches(uint32_t assigned,
+                                uint32_t subepoch_id,
+                                uint32_t total_subepochs,
+                                bool single_hop,
+                                bool boost_single_hop) {
     if (subepoch_id == assigned) {
         return true;
     }
@@ -166,58 +303,142 @@ uint64_t Fragment::temporal_aggregation(const TwoTuple& flow,
                           boost_single_hop)) {
             continue;
         }
-        // 找到匹配的 subepoch,查询并归一化(乘以 subepoch 总数)
+        // 找到匹配的 subepoch,查询并归一化(乘以 subepoch 总数与采样率倒数)
         uint64_t value = record.snapshot->query(flow);
-        value *= record.total_subepochs;
+        value *= static_cast<uint64_t>(record.total_subepochs) *
+                 record.sampling_rate;
         return value;
     }
     return 0;
 }
 
-void Fragment::update_sketch_and_rho(const TwoTuple& flow) {
+void Fragment::update_sketch_and_rho(const TwoTuple& flow, uint64_t count) {
+    if (shard_count_ > 1) {
+        pending_.push_back({flow, count});
+        if (pending_.size() >= shard_count_ * kShardBlockUpdates) {
+            apply_pending();
+        }
+        return;
+    }
+    accumulate_rho(update_and_measure(*sketch_, flow, count));
+}
+
+uint64_t Fragment::update_and_measure(Sketch& sketch,
+                                      const TwoTuple& flow,
+                                      uint64_t count) const {
+    if (setting_.kind == SketchKind::UnivMon) {
+        // UnivMon 只更新，无需计算 ρ
+        update_weighted(sketch, flow, count);
+        return 0;
+    }
+    // 查询更新前后的值，计算差值
+    uint64_t old_ = sketch.query(flow);
+    update_weighted(sketch, flow, count);
+    uint64_t new_ = sketch.query(flow);
+    if (setting_.kind == SketchKind::CountMin) {
+        return new_ - old_;
+    }
+    return new_ * new_ - old_ * old_;
+}
+
+uint64_t Fragment::sketch_width() const {
     switch (setting_.kind) {
         case SketchKind::CountMin: {
-            // CountMin: ρ̂ = Σc_i / w
-            // 查询更新前后的值，计算差值
-            uint64_t old_ = sketch_->query(flow);
-            sketch_->update(flow, 1);
-            uint64_t new_ = sketch_->query(flow);
-
             auto* cm = static_cast<const CountMin*>(sketch_.get());
             const auto& counters = cm->get_raw_data();
-            if (!counters.empty() && !counters[0].empty()) {
-                uint64_t width = counters[0].size();
-                // ρ_new = ρ_old + (new_ - old_) / width
-                current_rho_ += static_cast<double>(new_ - old_) /
-                                static_cast<double>(width);
-            }
-            break;
+            return counters.empty() ? 0 : counters[0].size();
         }
         case SketchKind::CountSketch: {
-            // CountSketch: ρ̂ = sqrt(Σc_i² / w)
-            // 查询更新前后的值，计算平方和的变化
-            uint64_t old_ = sketch_->query(flow);
-            sketch_->update(flow, 1);
-            uint64_t new_ = sketch_->query(flow);
-
             auto* cs = static_cast<const CountSketch*>(sketch_.get());
             const auto& counters = cs->get_raw_data();
-            if (!counters.empty() && !counters[0].empty()) {
-                uint64_t width = counters[0].size();
-                // ρ_new = sqrt( ρ_old² + (new_² - old_²) / width )
-                current_rho_ = std::sqrt(current_rho_ * current_rho_ +
-                                         (new_ * new_ - old_ * old_) /
-                                             static_cast<double>(width));
-            }
-            break;
+            return counters.empty() ? 0 : counters[0].size();
         }
         default:
-            // UnivMon 只更新，无需计算 ρ
-            sketch_->update(flow, 1);
+            return 0;
+    }
+}
+
+void Fragment::accumulate_rho(uint64_t delta) {
+    uint64_t width = sketch_width();
+    if (width == 0) {
+        return;
+    }
+    switch (setting_.kind) {
+        case SketchKind::CountMin:
+            // CountMin: ρ̂ = Σc_i / w
+            // ρ_new = ρ_old + (new_ - old_) / width
+            current_rho_ +=
+                static_cast<double>(delta) / static_cast<double>(width);
+            break;
+        case SketchKind::CountSketch:
+            // CountSketch: ρ̂ = sqrt(Σc_i² / w)
+            // ρ_new = sqrt( ρ_old² + (new_² - old_²) / width )
+            current_rho_ = std::sqrt(current_rho_ * current_rho_ +
+                                     delta / static_cast<double>(width));
+            break;
+        default:
             break;
     }
 }
 
+void Fragment::apply_pending() {
+    size_t total = pending_.size();
+    if (total == 0) {
+        return;
+    }
+    size_t shards = std::min<size_t>(
+        shard_count_, (total + kMinShardUpdates - 1) / kMinShardUpdates);
+    if (shards <= 1) {
+        for (const auto& update : pending_) {
+            accumulate_rho(
+                update_and_measure(*sketch_, update.flow, update.count));
+        }
+        pending_.clear();
+        return;
+    }
+
+    std::vector<size_t> bounds(shards + 1);
+    for (size_t j = 0; j <= shards; ++j) {
+        bounds[j] = total * j / shards;
+    }
+    while (shard_sketches_.size() < shards - 1) {
+        shard_sketches_.push_back(create_sketch());
+    }
+    rho_deltas_.resize(total);
+
+    // 第一遍：第 j 段 (j < K-1) 写入清零的 shard_sketches_[j]
+    shard_runner_->run(shards - 1, [&](size_t j) {
+        Sketch& partial = *shard_sketches_[j];
+        partial.clear();
+        for (size_t i = bounds[j]; i < bounds[j + 1]; ++i) {
+            update_weighted(partial, pending_[i].flow, pending_[i].count);
+        }
+    });
+
+    // 前缀求和：shard_sketches_[j] 成为第 j + 1 段开始时的完整状态
+    merge_sketch(setting_.kind, *shard_sketches_[0], *sketch_);
+    for (size_t j = 1; j + 1 < shards; ++j) {
+        merge_sketch(setting_.kind, *shard_sketches_[j],
+                     *shard_sketches_[j - 1]);
+    }
+
+    // 第二遍：各段从自己的起点重放，得到与逐个更新相同的查询结果
+    shard_runner_->run(shards, [&](size_t j) {
+        Sketch& sketch = j == 0 ? *sketch_ : *shard_sketches_[j - 1];
+        for (size_t i = bounds[j]; i < bounds[j + 1]; ++i) {
+            rho_deltas_[i] =
+                update_and_measure(sketch, pending_[i].flow, pending_[i].count);
+        }
+    });
+
+    // 最后一段重放后的状态包含全部更新
+    std::swap(sketch_, shard_sketches_[shards - 2]);
+    for (size_t i = 0; i < total; ++i) {
+        accumulate_rho(rho_deltas_[i]);
+    }
+    pending_.clear();
+}
+
 void Fragment::adjust_subepoch(double avg_rho) {
     // UnivMon 不进行动态调整
     if (setting_.kind == SketchKind::UnivMon) {
@@ -0,0 +1,183 @@
+#include "FragmentWorkers.h"
+
+#include <algorithm>
+
+namespace {
+
+// 每批最多包数
+constexpr size_t kTaskBatchSize = 1024;
+// 每个工作线程的环形队列批数
+constexpr size_t kRingBatches = 64;
+// 路径位图的位数限制了工作线程数
+constexpr size_t kMaxWorkers = 64;
+
+}  // namespace
+
+FragmentWorkerPool::FragmentWorkerPool(std::vector<Fragment>& fragments,
+                                       const std::vector<PathSetting>& paths,
+                                       size_t worker_count)
+    : fragments_(fragments),
+      paths_(paths.data()),
+      reports_(fragments.size()) {
+    worker_count = std::max<size_t>(
+        1, std::min({worker_count, fragments.size(), kMaxWorkers}));
+    for (size_t w = 0; w < worker_count; ++w) {
+        workers_.emplace_back(new Worker(kRingBatches));
+    }
+    owners_.resize(fragments.size());
+    for (size_t f = 0; f < fragments.size(); ++f) {
+        owners_[f] = f % worker_count;
+        workers_[owners_[f]]->fragments.push_back(static_cast<int>(f));
+    }
+    path_workers_.reserve(paths.size());
+    for (const auto& path : paths) {
+        uint64_t mask = 0;
+        for (int node_index : path.node_indices) {
+            mask |= 1ULL << owners_[node_index];
+        }
+        path_workers_.push_back(mask);
+    }
+    for (size_t w = 0; w < worker_count; ++w) {
+        workers_[w]->thread = std::thread(&FragmentWorkerPool::work, this, w);
+    }
+}
+
+FragmentWorkerPool::~FragmentWorkerPool() {
+    broadcast(FragmentBatch::Kind::Stop, 0, 0);
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+FragmentBatch* FragmentWorkerPool::acquire(Worker& worker) {
+    return worker.ring.wait_acquire([]() { return false; });
+}
+
+void FragmentWorkerPool::flush(Worker& worker) {
+    if (worker.pending != nullptr) {
+        worker.ring.publish();
+        worker.pending = nullptr;
+    }
+}
+
+void FragmentWorkerPool::broadcast(FragmentBatch::Kind kind,
+                                   uint64_t epoch_id,
+                                   uint64_t epoch_start_ns) {
+    for (auto& worker : workers_) {
+        // 命令必须排在已分发的包之后
+        flush(*worker);
+        FragmentBatch* slot = acquire(*worker);
+        slot->kind = kind;
+        slot->epoch_id = epoch_id;
+        slot->epoch_start_ns = epoch_start_ns;
+        slot->tasks.clear();
+        worker->ring.publish();
+    }
+}
+
+void FragmentWorkerPool::begin_epoch(uint64_t epoch_id,
+                                     uint64_t epoch_start_ns) {
+    broadcast(FragmentBatch::Kind::BeginEpoch, epoch_id, epoch_start_ns);
+}
+
+void FragmentWorkerPool::dispatch(const TwoTuple& flow,
+                                  uint64_t timestamp_ns,
+                                  const PathSetting& path) {
+    if (path.node_indices.empty()) {
+        return;
+    }
+    bool single_hop = path.node_indices.size() <= 1;
+    uint64_t mask = path_workers_[static_cast<size_t>(&path - paths_)];
+    while (mask != 0) {
+        size_t w = static_cast<size_t>(__builtin_ctzll(mask));
+        mask &= mask - 1;
+        Worker& worker = *workers_[w];
+        if (worker.pending == nullptr) {
+            worker.pending = acquire(worker);
+            worker.pending->kind = FragmentBatch::Kind::Packets;
+            worker.pending->tasks.clear();
+        }
+        worker.pending->tasks.push_back(
+            {flow, timestamp_ns, &path, single_hop});
+        if (worker.pending->tasks.size() >= kTaskBatchSize) {
+            flush(worker);
+        }
+    }
+}
+
+std::vector<FragmentEpochReport> FragmentWorkerPool::close_epoch() {
+    broadcast(FragmentBatch::Kind::CloseEpoch, 0, 0);
+
+    // 屏障：等待全部工作线程写完各自 fragment 的报告
+    barrier_.wait([this]() {
+        return closed_.load(std::memory_order_acquire) >= workers_.size();
+    });
+    closed_.store(0, std::memory_order_relaxed);
+
+    for (auto& worker : workers_) {
+        if (worker->error) {
+            std::rethrow_exception(worker->error);
+        }
+    }
+    // 换入新的空报告数组，工作线程下一次关闭 epoch 时写入
+    std::vector<FragmentEpochReport> reports(fragments_.size());
+    reports.swap(reports_);
+    return reports;
+}
+
+void FragmentWorkerPool::run_batch(size_t index, const FragmentBatch& batch) {
+    Worker& worker = *workers_[index];
+    switch (batch.kind) {
+        case FragmentBatch::Kind::Packets:
+            // 路径上不属于本线程的 fragment 由其他线程处理
+            for (const auto& task : batch.tasks) {
+                for (int node_index : task.path->node_indices) {
+                    if (owners_[node_index] == index) {
+                        fragments_[node_index].process_packet(
+                            task.flow, task.timestamp_ns, task.single_hop);
+                    }
+                }
+            }
+            break;
+        case FragmentBatch::Kind::BeginEpoch:
+            for (int f : worker.fragments) {
+                fragments_[f].begin_epoch(batch.epoch_id, batch.epoch_start_ns);
+            }
+            break;
+        case FragmentBatch::Kind::CloseEpoch:
+            for (int f : worker.fragments) {
+                reports_[f] = fragments_[f].close_epoch();
+            }
+            break;
+        case FragmentBatch::Kind::Stop:
+            break;
+    }
+}
+
+void FragmentWorkerPool::work(size_t index) {
+    Worker& worker = *workers_[index];
+    while (true) {
+        // 队列空闲时睡眠，直到分发线程发布下一批
+        FragmentBatch* batch = worker.ring.wait_front([]() { return false; });
+
+        FragmentBatch::Kind kind = batch->kind;
+        // 出错后继续消费队列，避免分发线程阻塞，错误在 close_epoch 中报告
+        if (!worker.error) {
+            try {
+                run_batch(index, *batch);
+            } catch (...) {
+                worker.error = std::current_exception();
+            }
+        }
+        worker.ring.release();
+
+        if (kind == FragmentBatch::Kind::CloseEpoch) {
+            closed_.fetch_add(1, std::memory_order_release);
+            barrier_.notify();
+        } else if (kind == FragmentBatch::Kind::Stop) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,297 @@
+#include "LiveCapture.h"
+
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// 单帧接收缓冲区，超出部分被截断，只需要链路层与 IP 头部
+constexpr size_t kFrameBufferSize = 2048;
+// 内核丢包计数的读取间隔
+constexpr uint64_t kStatsIntervalNs = 100000000;
+
+inline uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+std::runtime_error socket_error(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+}  // namespace
+
+LiveCaptureSource::LiveCaptureSource(const LiveCaptureConfig& config)
+    : config_(config), ring_(config.ring_batches) {
+    config_.batch_size = std::max<size_t>(1, config_.batch_size);
+    try {
+        open_socket();
+    } catch (...) {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        throw;
+    }
+    start_ns_ = now_ns();
+    watermark_.store(start_ns_, std::memory_order_relaxed);
+    producer_ = std::thread(&LiveCaptureSource::capture, this);
+}
+
+LiveCaptureSource::~LiveCaptureSource() {
+    stop();
+    if (producer_.joinable()) {
+        producer_.join();
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void LiveCaptureSource::open_socket() {
+    fd_ = ::socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (fd_ < 0) {
+        throw socket_error("Failed to open AF_PACKET socket");
+    }
+
+    struct ifreq ifr;
+    std::memset(&ifr, 0, sizeof(ifr));
+    std::strncpy(ifr.ifr_name, config_.interface.c_str(), IFNAMSIZ - 1);
+    if (::ioctl(fd_, SIOCGIFINDEX, &ifr) < 0) {
+        throw socket_error("Unknown capture interface " + config_.interface);
+    }
+    int ifindex = ifr.ifr_ifindex;
+
+    // 以太网与回环网卡带以太网头部，ARPHRD_NONE（如 tun）直接是 IP 包
+    if (::ioctl(fd_, SIOCGIFHWADDR, &ifr) < 0) {
+        throw socket_error("Failed to query interface " + config_.interface);
+    }
+    switch (ifr.ifr_hwaddr.sa_family) {
+        case ARPHRD_ETHER:
+            link_type_ = pcpp::LINKTYPE_ETHERNET;
+            break;
+        case ARPHRD_LOOPBACK:
+            link_type_ = pcpp::LINKTYPE_ETHERNET;
+            loopback_ = true;
+            break;
+        case ARPHRD_NONE:
+            link_type_ = pcpp::LINKTYPE_RAW;
+            break;
+        default:
+            throw std::runtime_error("Unsupported link type on interface " +
+                                     config_.interface);
+    }
+
+    struct sockaddr_ll addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = ifindex;
+    if (::bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) <
+        0) {
+        throw socket_error("Failed to bind to " + config_.interface);
+    }
+
+    // 缓冲区大小只是建议值，设置失败时沿用系统默认
+    int buffer = static_cast<int>(config_.socket_buffer);
+    ::setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+
+    if (config_.promiscuous) {
+        struct packet_mreq mreq;
+        std::memset(&mreq, 0, sizeof(mreq));
+        mreq.mr_ifindex = ifindex;
+        mreq.mr_type = PACKET_MR_PROMISC;
+        if (::setsockopt(fd_, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq,
+                         sizeof(mreq)) < 0) {
+            throw socket_error("Failed to enable promiscuous mode");
+        }
+    }
+
+    // 丢弃绑定前已排队的计数
+    poll_kernel_drops();
+    kernel_drops_.store(0, std::memory_order_relaxed);
+}
+
+void LiveCaptureSource::poll_kernel_drops() {
+    struct tpacket_stats stats;
+    socklen_t length = sizeof(stats);
+    if (::getsockopt(fd_, SOL_PACKET, PACKET_STATISTICS, &stats, &length) ==
+        0) {
+        kernel_drops_.fetch_add(stats.tp_drops, std::memory_order_relaxed);
+    }
+}
+
+void LiveCaptureSource::capture() {
+    try {
+        uint8_t frame[kFrameBufferSize];
+        std::vector<PacketRecord>* slot = nullptr;
+        uint64_t slot_first_ns = 0;  // 当前批第一个包的到达时间
+        uint64_t next_stats_ns = start_ns_ + kStatsIntervalNs;
+
+        // 把当前批交给消费者；此后时间戳早于当前时刻的包都已发布
+        auto flush = [this, &slot]() {
+            if (slot != nullptr && !slot->empty()) {
+                ring_.publish();
+                slot = nullptr;
+            }
+            watermark_.store(now_ns(), std::memory_order_release);
+        };
+
+        while (!stop_.load(std::memory_order_relaxed)) {
+            uint64_t now = now_ns();
+            if (config_.duration_ns > 0 &&
+                now - start_ns_ >= config_.duration_ns) {
+                break;
+            }
+            if (now >= next_stats_ns) {
+                poll_kernel_drops();
+                next_stats_ns = now + kStatsIntervalNs;
+            }
+            if (slot == nullptr || slot->empty()) {
+                // 没有未发布的包，水位跟上当前时刻
+                watermark_.store(now, std::memory_order_release);
+            } else if (now - slot_first_ns >= config_.flush_ns) {
+                flush();
+            } else {
+                uint64_t flush_at = flush_at_.load(std::memory_order_relaxed);
+                if (slot_first_ns < flush_at && now >= flush_at) {
+                    flush();
+                }
+            }
+
+            struct sockaddr_ll from;
+            socklen_t from_len = sizeof(from);
+            ssize_t length = ::recvfrom(
+                fd_, frame, sizeof(frame), MSG_DONTWAIT | MSG_TRUNC,
+                reinterpret_cast<struct sockaddr*>(&from), &from_len);
+            if (length < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                    // 没有数据时先交出未满的批，再短暂等待
+                    flush();
+                    struct pollfd pfd = {fd_, POLLIN, 0};
+                    ::poll(&pfd, 1, 1);
+                    continue;
+                }
+                throw socket_error("Failed to receive from " +
+                                   config_.interface);
+            }
+            if (loopback_ && from.sll_pkttype == PACKET_OUTGOING) {
+                continue;
+            }
+            uint64_t ts = now_ns();
+            received_.fetch_add(1, std::memory_order_relaxed);
+
+            PacketRecord record;
+            size_t captured =
+                std::min(static_cast<size_t>(length), sizeof(frame));
+            if (decode_ipv4_flow(frame, captured, link_type_, record.flow) !=
+                DecodeStatus::Ok) {
+                not_ipv4_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            record.timestamp = std::chrono::nanoseconds(ts);
+
+            if (slot == nullptr) {
+                slot = ring_.try_acquire();
+                if (slot == nullptr) {
+                    // 消费者跟不上，丢包而不阻塞抓包
+                    ring_drops_.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                slot->clear();
+                slot_first_ns = ts;
+            }
+            slot->push_back(record);
+            delivered_.fetch_add(1, std::memory_order_relaxed);
+            if (slot->size() >= config_.batch_size) {
+                flush();
+            }
+        }
+        flush();
+        poll_kernel_drops();
+    } catch (...) {
+        error_ = std::current_exception();
+    }
+    producer_done_.store(true, std::memory_order_release);
+}
+
+bool LiveCaptureSource::start_time(uint64_t& start_ts) const {
+    start_ts = start_ns_;
+    return true;
+}
+
+bool LiveCaptureSource::wait_for_data(uint64_t deadline_ts) {
+    if (current_ != nullptr && position_ < current_->size()) {
+        return true;
+    }
+    unsigned spins = 0;
+    bool requested = false;
+    while (true) {
+        if (ring_.try_front() != nullptr ||
+            producer_done_.load(std::memory_order_acquire)) {
+            return true;
+        }
+        if (watermark_.load(std::memory_order_acquire) >= deadline_ts) {
+            // 水位之前的批都已发布，再确认一次刚发布的批是否已可读
+            return ring_.try_front() != nullptr;
+        }
+        if (!requested && now_ns() >= deadline_ts) {
+            flush_at_.store(deadline_ts, std::memory_order_relaxed);
+            requested = true;
+        }
+        spsc_backoff(spins);
+    }
+}
+
+size_t LiveCaptureSource::next_batch(const PacketRecord*& batch,
+                                     size_t max_count) {
+    if (current_ != nullptr && position_ >= current_->size()) {
+        ring_.release();
+        current_ = nullptr;
+    }
+    if (current_ == nullptr) {
+        unsigned spins = 0;
+        while ((current_ = ring_.try_front()) == nullptr) {
+            // 先读完成标志再确认队列为空，避免漏掉最后一批
+            if (producer_done_.load(std::memory_order_acquire)) {
+                current_ = ring_.try_front();
+                if (current_ != nullptr) {
+                    break;
+                }
+                if (error_) {
+                    std::rethrow_exception(error_);
+                }
+                return 0;
+            }
+            spsc_backoff(spins);
+        }
+        position_ = 0;
+    }
+
+    size_t count = std::min(max_count, current_->size() - position_);
+    batch = current_->data() + position_;
+    position_ += count;
+    return count;
+}
+
+CaptureCounters LiveCaptureSource::counters() const {
+    CaptureCounters result;
+    result.received = received_.load(std::memory_order_relaxed);
+    result.delivered = delivered_.load(std::memory_order_relaxed);
+    result.not_ipv4 = not_ipv4_.load(std::memory_order_relaxed);
+    result.ring_drops = ring_drops_.load(std::memory_order_relaxed);
+    result.kernel_drops = kernel_drops_.load(std::memory_order_relaxed);
+    return result;
+}
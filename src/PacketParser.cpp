@@ -1,5 +1,11 @@
 #include "PacketParser.h"
 
+#include "IPv6Layer.h"
+#include "ParallelRun.h"
+#include "TraceIndex.h"
+#include "TcpLayer.h"
+#include "UdpLayer.h"
+
 uint32_t ip_string_to_uint32(const std::string& ip_str) {
     uint32_t result = 0;
     std::istringstream iss(ip_str);
@@ -41,6 +47,389 @@ size_t estimate_packet_count(const std::string& file_path) {
     return estimated_packets > 0 ? estimated_packets : 10000;
 }
 
+namespace {
+
+constexpr uint16_t ETHERTYPE_IPV4 = 0x0800;
+constexpr uint16_t ETHERTYPE_IPV6 = 0x86dd;
+constexpr uint16_t ETHERTYPE_ARP = 0x0806;
+constexpr uint16_t ETHERTYPE_VLAN = 0x8100;
+constexpr uint16_t ETHERTYPE_QINQ = 0x88a8;
+
+constexpr size_t ETH_HEADER_LEN = 14;
+constexpr size_t VLAN_HEADER_LEN = 4;
+constexpr size_t SLL_HEADER_LEN = 16;
+constexpr size_t SLL2_HEADER_LEN = 20;
+constexpr size_t IPV4_MIN_HEADER_LEN = 20;
+constexpr size_t IPV6_HEADER_LEN = 40;
+
+inline uint16_t load_be16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+// 与 IPv4Layer::isDataValid 相同的校验
+inline bool valid_ipv4(const uint8_t* data, size_t length) {
+    return length >= IPV4_MIN_HEADER_LEN && (data[0] >> 4) == 4 &&
+           (data[0] & 0x0f) >= 5;
+}
+
+inline DecodeStatus decode_ipv4(const uint8_t* data,
+                                size_t length,
+                                TwoTuple& flow) {
+    if (!valid_ipv4(data, length)) {
+        return DecodeStatus::NotIPv4;
+    }
+    // 与 IPv4Address::toInt() 一致，直接保留网络字节序
+    std::memcpy(&flow.src_ip, data + 12, sizeof(uint32_t));
+    std::memcpy(&flow.dst_ip, data + 16, sizeof(uint32_t));
+    return DecodeStatus::Ok;
+}
+
+inline DecodeStatus decode_ipv4(const uint8_t* data,
+                                size_t length,
+                                FiveTuple& flow) {
+    if (!valid_ipv4(data, length)) {
+        return DecodeStatus::NotIPv4;
+    }
+    std::memcpy(&flow.src_ip, data + 12, sizeof(uint32_t));
+    std::memcpy(&flow.dst_ip, data + 16, sizeof(uint32_t));
+    flow.protocol = data[9];
+    flow.src_port = 0;
+    flow.dst_port = 0;
+
+    // 与 IPv4Layer 一致：总长度字段可以截短数据，分片不解析传输层
+    size_t header_len = static_cast<size_t>(data[0] & 0x0f) * 4;
+    size_t total_len = load_be16(data + 2);
+    if (total_len != 0 && total_len < length) {
+        length = std::max(total_len, header_len);
+    }
+    bool fragment = (load_be16(data + 6) & 0x3fff) != 0;
+    if (fragment || length <= header_len) {
+        return DecodeStatus::Ok;
+    }
+
+    // 与 TcpLayer/UdpLayer::isDataValid 一致，头部不完整时没有端口
+    const uint8_t* l4 = data + header_len;
+    size_t l4_len = length - header_len;
+    bool has_ports = false;
+    if (flow.protocol == 6) {
+        size_t data_offset = static_cast<size_t>(l4_len >= 13 ? l4[12] >> 4 : 0);
+        has_ports = l4_len >= 20 && data_offset >= 5 && l4_len >= data_offset * 4;
+    } else if (flow.protocol == 17) {
+        has_ports = l4_len >= 8;
+    }
+    if (has_ports) {
+        flow.src_port = load_be16(l4);
+        flow.dst_port = load_be16(l4 + 2);
+    }
+    return DecodeStatus::Ok;
+}
+
+inline DecodeStatus decode_ipv4(const uint8_t* data,
+                                size_t length,
+                                IPv6TwoTuple& flow) {
+    if (!valid_ipv4(data, length)) {
+        return DecodeStatus::NotIPv4;
+    }
+    // IPv4 映射地址 ::ffff:a.b.c.d
+    static const uint8_t mapped_prefix[12] = {0, 0, 0, 0, 0, 0,
+                                              0, 0, 0, 0, 0xff, 0xff};
+    std::memcpy(flow.src_ip, mapped_prefix, sizeof(mapped_prefix));
+    std::memcpy(flow.src_ip + 12, data + 12, sizeof(uint32_t));
+    std::memcpy(flow.dst_ip, mapped_prefix, sizeof(mapped_prefix));
+    std::memcpy(flow.dst_ip + 12, data + 16, sizeof(uint32_t));
+    return DecodeStatus::Ok;
+}
+
+// IPv6 内部仍可能封装 IPv4（IPIP、GRE、扩展头之后），交给 pcpp 处理
+inline DecodeStatus decode_ipv6_inner(const uint8_t* data, size_t length) {
+    if (length <= IPV6_HEADER_LEN || (data[0] >> 4) != 6) {
+        return DecodeStatus::NotIPv4;
+    }
+    switch (data[6]) {
+        case 6:   // TCP
+        case 17:  // UDP
+        case 58:  // ICMPv6
+        case 59:  // No Next Header
+            return DecodeStatus::NotIPv4;
+        default:
+            return DecodeStatus::Unsupported;
+    }
+}
+
+inline DecodeStatus decode_ipv6(const uint8_t* data,
+                                size_t length,
+                                TwoTuple&) {
+    return decode_ipv6_inner(data, length);
+}
+
+inline DecodeStatus decode_ipv6(const uint8_t* data,
+                                size_t length,
+                                FiveTuple&) {
+    return decode_ipv6_inner(data, length);
+}
+
+// IPv6 键取最外层的 IPv6 地址，与 IPv6Layer 的校验一致
+inline DecodeStatus decode_ipv6(const uint8_t* data,
+                                size_t length,
+                                IPv6TwoTuple& flow) {
+    if (length < IPV6_HEADER_LEN || (data[0] >> 4) != 6) {
+        return DecodeStatus::NotIPv4;
+    }
+    std::memcpy(flow.src_ip, data + 8, sizeof(flow.src_ip));
+    std::memcpy(flow.dst_ip, data + 24, sizeof(flow.dst_ip));
+    return DecodeStatus::Ok;
+}
+
+// 从 EtherType 开始解码，依次剥离 VLAN 标签
+template <typename Key>
+inline DecodeStatus decode_ethertype(uint16_t ether_type,
+                                     const uint8_t* payload,
+                                     size_t length,
+                                     Key& flow) {
+    while (ether_type == ETHERTYPE_VLAN || ether_type == ETHERTYPE_QINQ) {
+        if (length <= VLAN_HEADER_LEN) {
+            return DecodeStatus::NotIPv4;
+        }
+        ether_type = load_be16(payload + 2);
+        payload += VLAN_HEADER_LEN;
+        length -= VLAN_HEADER_LEN;
+    }
+
+    switch (ether_type) {
+        case ETHERTYPE_IPV4:
+            return decode_ipv4(payload, length, flow);
+        case ETHERTYPE_IPV6:
+            return decode_ipv6(payload, length, flow);
+        case ETHERTYPE_ARP:
+            return DecodeStatus::NotIPv4;
+        default:
+            // MPLS、PPPoE 等封装交给 pcpp
+            return DecodeStatus::Unsupported;
+    }
+}
+
+template <typename Key>
+DecodeStatus decode_link(const uint8_t* data,
+                         size_t length,
+                         pcpp::LinkLayerType link_type,
+                         Key& flow) {
+    if (data == nullptr || length == 0) {
+        return DecodeStatus::NotIPv4;
+    }
+
+    switch (link_type) {
+        case pcpp::LINKTYPE_ETHERNET: {
+            if (length < ETH_HEADER_LEN) {
+                return DecodeStatus::Unsupported;
+            }
+            uint16_t ether_type = load_be16(data + 12);
+            // 小于 0x0600 是 802.3 长度字段，交给 pcpp
+            if (ether_type < 0x0600) {
+                return DecodeStatus::Unsupported;
+            }
+            if (length == ETH_HEADER_LEN) {
+                return DecodeStatus::NotIPv4;
+            }
+            return decode_ethertype(ether_type, data + ETH_HEADER_LEN,
+                                    length - ETH_HEADER_LEN, flow);
+        }
+        case pcpp::LINKTYPE_LINUX_SLL:
+            if (length <= SLL_HEADER_LEN) {
+                return DecodeStatus::NotIPv4;
+            }
+            return decode_ethertype(load_be16(data + 14),
+                                    data + SLL_HEADER_LEN,
+                                    length - SLL_HEADER_LEN, flow);
+        case pcpp::LINKTYPE_LINUX_SLL2:
+            if (length <= SLL2_HEADER_LEN) {
+                return DecodeStatus::NotIPv4;
+            }
+            return decode_ethertype(load_be16(data), data + SLL2_HEADER_LEN,
+                                    length - SLL2_HEADER_LEN, flow);
+        case pcpp::LINKTYPE_RAW:
+        case pcpp::LINKTYPE_DLT_RAW1:
+        case pcpp::LINKTYPE_DLT_RAW2:
+            switch (data[0] >> 4) {
+                case 4:
+                    return decode_ipv4(data, length, flow);
+                case 6:
+                    return decode_ipv6(data, length, flow);
+                default:
+                    return DecodeStatus::NotIPv4;
+            }
+        case pcpp::LINKTYPE_IPV4:
+            return decode_ipv4(data, length, flow);
+        default:
+            return DecodeStatus::Unsupported;
+    }
+}
+
+// 回退到 PcapPlusPlus 完整解析
+bool pcpp_extract_flow(pcpp::RawPacket& raw_packet, TwoTuple& flow) {
+    pcpp::Packet parsed_packet(&raw_packet, pcpp::OsiModelNetworkLayer);
+    auto* ipv4_layer = parsed_packet.getLayerOfType<pcpp::IPv4Layer>();
+    if (!ipv4_layer) {
+        return false;
+    }
+    flow.src_ip = ipv4_layer->getSrcIPv4Address().toInt();
+    flow.dst_ip = ipv4_layer->getDstIPv4Address().toInt();
+    return true;
+}
+
+bool pcpp_extract_flow(pcpp::RawPacket& raw_packet, FiveTuple& flow) {
+    pcpp::Packet parsed_packet(&raw_packet, pcpp::OsiModelTransportLayer);
+    auto* ipv4_layer = parsed_packet.getLayerOfType<pcpp::IPv4Layer>();
+    if (!ipv4_layer) {
+        return false;
+    }
+    flow = FiveTuple();
+    flow.src_ip = ipv4_layer->getSrcIPv4Address().toInt();
+    flow.dst_ip = ipv4_layer->getDstIPv4Address().toInt();
+    flow.protocol = ipv4_layer->getIPv4Header()->protocol;
+    // 只取紧跟在该 IPv4 头部之后的传输层
+    pcpp::Layer* next = ipv4_layer->getNextLayer();
+    if (auto* tcp = dynamic_cast<pcpp::TcpLayer*>(next)) {
+        flow.src_port = tcp->getSrcPort();
+        flow.dst_port = tcp->getDstPort();
+    } else if (auto* udp = dynamic_cast<pcpp::UdpLayer*>(next)) {
+        flow.src_port = udp->getSrcPort();
+        flow.dst_port = udp->getDstPort();
+    }
+    return true;
+}
+
+bool pcpp_extract_flow(pcpp::RawPacket& raw_packet, IPv6TwoTuple& flow) {
+    pcpp::Packet parsed_packet(&raw_packet, pcpp::OsiModelNetworkLayer);
+    // 取最外层的 IP 头部，与快速路径一致
+    for (pcpp::Layer* layer = parsed_packet.getFirstLayer(); layer != nullptr;
+         layer = layer->getNextLayer()) {
+        if (auto* ipv4_layer = dynamic_cast<pcpp::IPv4Layer*>(layer)) {
+            return decode_ipv4(ipv4_layer->getData(),
+                               ipv4_layer->getDataLen(),
+                               flow) == DecodeStatus::Ok;
+        }
+        if (auto* ipv6_layer = dynamic_cast<pcpp::IPv6Layer*>(layer)) {
+            return decode_ipv6(ipv6_layer->getData(),
+                               ipv6_layer->getDataLen(),
+                               flow) == DecodeStatus::Ok;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+DecodeStatus decode_ipv4_flow(const uint8_t* data,
+                              size_t length,
+                              pcpp::LinkLayerType link_type,
+                              TwoTuple& flow) {
+    return decode_link(data, length, link_type, flow);
+}
+
+DecodeStatus decode_flow(const uint8_t* data,
+                         size_t length,
+                         pcpp::LinkLayerType link_type,
+                         FiveTuple& flow) {
+    return decode_link(data, length, link_type, flow);
+}
+
+DecodeStatus decode_flow(const uint8_t* data,
+                         size_t length,
+                         pcpp::LinkLayerType link_type,
+                         IPv6TwoTuple& flow) {
+    return decode_link(data, length, link_type, flow);
+}
+
+namespace {
+
+// 64 位时间戳的 LSD 基数排序，每轮处理 16 位，仅覆盖实际取值范围
+template <typename Record>
+void radix_sort_by_timestamp(std::vector<Record>& packets) {
+    constexpr int DIGIT_BITS = 16;
+    constexpr size_t BUCKETS = size_t{1} << DIGIT_BITS;
+
+    uint64_t min_ts = UINT64_MAX;
+    uint64_t max_ts = 0;
+    for (const auto& pkt : packets) {
+        uint64_t ts = static_cast<uint64_t>(pkt.timestamp.count());
+        min_ts = std::min(min_ts, ts);
+        max_ts = std::max(max_ts, ts);
+    }
+
+    std::vector<Record> buffer(packets.size());
+    std::vector<size_t> counts(BUCKETS);
+    const uint64_t range = max_ts - min_ts;
+    for (int shift = 0; shift < 64 && (range >> shift) != 0;
+         shift += DIGIT_BITS) {
+        std::fill(counts.begin(), counts.end(), 0);
+        for (const auto& pkt : packets) {
+            uint64_t key = static_cast<uint64_t>(pkt.timestamp.count()) - min_ts;
+            counts[(key >> shift) & (BUCKETS - 1)] += 1;
+        }
+        size_t sum = 0;
+        for (auto& count : counts) {
+            size_t current = count;
+            count = sum;
+            sum += current;
+        }
+        for (const auto& pkt : packets) {
+            uint64_t key = static_cast<uint64_t>(pkt.timestamp.count()) - min_ts;
+            buffer[counts[(key >> shift) & (BUCKETS - 1)]++] = pkt;
+        }
+        packets.swap(buffer);
+    }
+}
+
+}  // namespace
+
+template <typename Key>
+void sort_by_timestamp(std::vector<BasicPacketRecord<Key>>& packets,
+                       size_t descents) {
+    using Record = BasicPacketRecord<Key>;
+    if (descents == 0 || packets.size() < 2) {
+        return;
+    }
+
+    // 逆序过多时整体已接近随机，直接基数排序
+    constexpr size_t RADIX_DESCENT_RATIO = 16;
+    if (descents > packets.size() / RADIX_DESCENT_RATIO) {
+        radix_sort_by_timestamp(packets);
+        return;
+    }
+
+    // 抽出不低于当前最大值的主序列，剩余的迟到包放入旁路序列
+    std::vector<Record> late;
+    size_t kept = 0;
+    auto running_max = packets.front().timestamp;
+    for (size_t i = 0; i < packets.size(); ++i) {
+        const Record& pkt = packets[i];
+        if (pkt.timestamp >= running_max) {
+            running_max = pkt.timestamp;
+            packets[kept++] = pkt;
+        } else {
+            late.push_back(pkt);
+        }
+    }
+    packets.resize(kept);
+
+    auto by_timestamp = [](const Record& a, const Record& b) {
+        return a.timestamp < b.timestamp;
+    };
+    if (late.size() > packets.size() / 4) {
+        packets.insert(packets.end(), late.begin(), late.end());
+        radix_sort_by_timestamp(packets);
+        return;
+    }
+
+    // 旁路序列很短，排序后与主序列做一次线性归并
+    std::stable_sort(late.begin(), late.end(), by_timestamp);
+    std::vector<Record> merged;
+    merged.reserve(packets.size() + late.size());
+    std::merge(packets.begin(), packets.end(), late.begin(), late.end(),
+               std::back_inserter(merged), by_timestamp);
+    packets.swap(merged);
+}
+
 // Pcap File Struct
 namespace {
 
@@ -68,58 +457,160 @@ struct PcapPacketHeader {
 };
 #pragma pack(pop)
 
-}  // namespace
-
-PcapReader::PcapReader(const std::string& filename)
-    : filename_(filename),
-      is_big_endian_(false),
-      has_nano_precision_(false),
-      link_type_(pcpp::LINKTYPE_ETHERNET) {}
-
-bool PcapReader::open() {
-    file_.open(filename_, std::ios::binary);
-    if (!file_) {
-        return false;
-    }
-
-    PcapFileHeader header;
-    file_.read(reinterpret_cast<char*>(&header), sizeof(header));
-    if (!file_) {
-        return false;
-    }
-
+// 解析文件头的 magic 与链路类型，magic 不识别时返回 false
+bool parse_file_header(PcapFileHeader header,
+                       bool& is_big_endian,
+                       bool& has_nano_precision,
+                       pcpp::LinkLayerType& link_type) {
     switch (header.magic_number) {
         case MAGIC_MICROSECONDS_LE:
-            is_big_endian_ = false;
-            has_nano_precision_ = false;
+            is_big_endian = false;
+            has_nano_precision = false;
             break;
         case MAGIC_MICROSECONDS_BE:
-            is_big_endian_ = true;
-            has_nano_precision_ = false;
+            is_big_endian = true;
+            has_nano_precision = false;
             break;
         case MAGIC_NANOSECONDS_LE:
-            is_big_endian_ = false;
-            has_nano_precision_ = true;
+            is_big_endian = false;
+            has_nano_precision = true;
             break;
         case MAGIC_NANOSECONDS_BE:
-            is_big_endian_ = true;
-            has_nano_precision_ = true;
+            is_big_endian = true;
+            has_nano_precision = true;
             break;
         default:
             return false;
     }
 
-    if (is_big_endian_) {
+    if (is_big_endian) {
         header.network = swap_bytes32(header.network);
     }
 
     if (pcpp::RawPacket::isLinkTypeValid(static_cast<int>(header.network))) {
-        link_type_ = static_cast<pcpp::LinkLayerType>(header.network);
+        link_type = static_cast<pcpp::LinkLayerType>(header.network);
     }
 
     return true;
 }
 
+// pcapng 块类型
+constexpr uint32_t PCAPNG_SECTION_HEADER = 0x0a0d0d0a;
+constexpr uint32_t PCAPNG_INTERFACE_DESCRIPTION = 0x00000001;
+constexpr uint32_t PCAPNG_OBSOLETE_PACKET = 0x00000002;
+constexpr uint32_t PCAPNG_ENHANCED_PACKET = 0x00000006;
+constexpr uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1a2b3c4d;
+
+// interface description block 的选项
+constexpr uint16_t PCAPNG_OPT_END = 0;
+constexpr uint16_t PCAPNG_OPT_IF_TSRESOL = 9;
+constexpr uint16_t PCAPNG_OPT_IF_TSOFFSET = 14;
+
+// 需要整块读入的 pcapng 块长度上限，超出视为文件损坏
+constexpr uint32_t PCAPNG_MAX_BLOCK_LEN = 16 * 1024 * 1024;
+
+/* 把 pcapng 时间戳换算为纳秒
+ * @param resolution if_tsresol：最高位为 0 时单位是 10^-n 秒，为 1 时是 2^-n 秒
+ */
+uint64_t pcapng_timestamp_ns(uint64_t ts,
+                             uint8_t resolution,
+                             int64_t offset_sec) {
+    const uint32_t exponent = resolution & 0x7f;
+    uint64_t ns;
+    if (resolution & 0x80) {
+        uint32_t shift = std::min<uint32_t>(exponent, 63);
+        unsigned __int128 fraction = ts & ((uint64_t{1} << shift) - 1);
+        ns = (ts >> shift) * 1000000000ULL +
+             static_cast<uint64_t>((fraction * 1000000000ULL) >> shift);
+    } else if (exponent <= 9) {
+        uint64_t scale = 1;
+        for (uint32_t i = exponent; i < 9; ++i) {
+            scale *= 10;
+        }
+        ns = ts * scale;
+    } else {
+        // 10^19 已超过 64 位时间戳的表示范围
+        uint64_t scale = 1;
+        for (uint32_t i = 9; i < std::min<uint32_t>(exponent, 28); ++i) {
+            scale *= 10;
+        }
+        ns = ts / scale;
+    }
+    return ns + static_cast<uint64_t>(offset_sec) * 1000000000ULL;
+}
+
+}  // namespace
+
+TraceFormat detect_trace_format(const std::string& file_path) {
+    std::ifstream file(file_path, std::ios::binary);
+    uint8_t magic[6] = {0, 0, 0, 0, 0, 0};
+    file.read(reinterpret_cast<char*>(magic), sizeof(magic));
+    if (file.gcount() < 4) {
+        return TraceFormat::Unknown;
+    }
+
+    if (magic[0] == 0x1f && magic[1] == 0x8b) {
+        return TraceFormat::Gzip;
+    }
+    if (magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f &&
+        magic[3] == 0xfd) {
+        return TraceFormat::Zstd;
+    }
+    if (file.gcount() == 6 && magic[0] == 0xfd &&
+        std::memcmp(magic + 1, "7zXZ", 4) == 0 && magic[5] == 0x00) {
+        return TraceFormat::Xz;
+    }
+
+    uint32_t word;
+    std::memcpy(&word, magic, sizeof(word));
+    switch (word) {
+        case PCAPNG_SECTION_HEADER:
+            return TraceFormat::PcapNg;
+        case MAGIC_MICROSECONDS_LE:
+        case MAGIC_MICROSECONDS_BE:
+        case MAGIC_NANOSECONDS_LE:
+        case MAGIC_NANOSECONDS_BE:
+            return TraceFormat::Pcap;
+        default:
+            return TraceFormat::Unknown;
+    }
+}
+
+const char* trace_decompressor(TraceFormat format) {
+    switch (format) {
+        case TraceFormat::Gzip:
+            return "gzip";
+        case TraceFormat::Zstd:
+            return "zstd";
+        case TraceFormat::Xz:
+            return "xz";
+        default:
+            return nullptr;
+    }
+}
+
+PcapReader::PcapReader(const std::string& filename)
+    : filename_(filename),
+      is_big_endian_(false),
+      has_nano_precision_(false),
+      link_type_(pcpp::LINKTYPE_ETHERNET) {}
+
+bool PcapReader::open() {
+    file_.open(filename_, std::ios::binary);
+    if (!file_) {
+        return false;
+    }
+
+    PcapFileHeader header;
+    file_.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file_) {
+        return false;
+    }
+
+    return parse_file_header(header, is_big_endian_, has_nano_precision_,
+                             link_type_);
+}
+
 bool PcapReader::get_next_packet(pcpp::RawPacket& raw_packet) {
     raw_packet.clear();
 
@@ -184,10 +675,531 @@ void PcapReader::close() {
     }
 }
 
-PacketParser::PacketVector PacketParser::parse_pcap(
-    const std::string& file_path) const {
+MmapPcapReader::MmapPcapReader(const std::string& filename)
+    : filename_(filename),
+      offset_(0),
+      end_(0),
+      snaplen_(0),
+      is_big_endian_(false),
+      has_nano_precision_(false),
+      link_type_(pcpp::LINKTYPE_ETHERNET) {}
+
+bool MmapPcapReader::open() {
+    if (!file_.open(filename_)) {
+        return false;
+    }
+    if (file_.size() < sizeof(PcapFileHeader)) {
+        file_.close();
+        return false;
+    }
+
+    PcapFileHeader header;
+    std::memcpy(&header, file_.data(), sizeof(header));
+    if (!parse_file_header(header, is_big_endian_, has_nano_precision_,
+                           link_type_)) {
+        file_.close();
+        return false;
+    }
+    snaplen_ = is_big_endian_ ? swap_bytes32(header.snaplen) : header.snaplen;
+
+    data_ = file_.data();
+    size_ = file_.size();
+    offset_ = sizeof(PcapFileHeader);
+    end_ = size_;
+    return true;
+}
+
+void MmapPcapReader::set_range(size_t begin, size_t end) {
+    offset_ = std::max(begin, sizeof(PcapFileHeader));
+    end_ = std::min(end, size_);
+}
+
+MmapPcapReader MmapPcapReader::view(size_t begin, size_t end) const {
+    MmapPcapReader view(filename_);
+    view.data_ = data_;
+    view.size_ = size_;
+    view.snaplen_ = snaplen_;
+    view.is_big_endian_ = is_big_endian_;
+    view.has_nano_precision_ = has_nano_precision_;
+    view.link_type_ = link_type_;
+    view.set_range(begin, end);
+    return view;
+}
+
+void MmapPcapReader::load_header(size_t offset, uint32_t fields[4]) const {
+    std::memcpy(fields, data_ + offset, sizeof(PcapPacketHeader));
+    if (is_big_endian_) {
+        for (int i = 0; i < 4; ++i) {
+            fields[i] = swap_bytes32(fields[i]);
+        }
+    }
+}
+
+size_t MmapPcapReader::find_record_boundary(size_t from) const {
+    // 连续校验的记录头数量，越多越不容易把载荷误认为记录头
+    constexpr int CHAIN_LENGTH = 8;
+    // 相邻记录的时间差上限（秒）
+    constexpr uint32_t MAX_GAP_SEC = 3600;
+
+    const size_t size = size_;
+    const uint32_t max_len =
+        std::max<uint32_t>(snaplen_, PCPP_MAX_PACKET_SIZE);
+    const uint32_t sub_second_limit =
+        has_nano_precision_ ? 1000000000U : 1000000U;
+
+    from = std::max(from, sizeof(PcapFileHeader));
+    for (size_t candidate = from;
+         candidate + sizeof(PcapPacketHeader) <= size; ++candidate) {
+        size_t offset = candidate;
+        uint32_t prev_sec = 0;
+        bool valid = true;
+        for (int i = 0; i < CHAIN_LENGTH && offset < size; ++i) {
+            if (size - offset < sizeof(PcapPacketHeader)) {
+                valid = false;
+                break;
+            }
+            uint32_t fields[4];  // ts_sec, ts_usec, incl_len, orig_len
+            load_header(offset, fields);
+            uint32_t gap = fields[0] > prev_sec ? fields[0] - prev_sec
+                                                : prev_sec - fields[0];
+            if (fields[1] >= sub_second_limit || fields[2] > max_len ||
+                fields[2] > fields[3] ||
+                (i > 0 && gap > MAX_GAP_SEC) ||
+                size - offset - sizeof(PcapPacketHeader) < fields[2]) {
+                valid = false;
+                break;
+            }
+            prev_sec = fields[0];
+            offset += sizeof(PcapPacketHeader) + fields[2];
+        }
+        if (valid) {
+            return candidate;
+        }
+    }
+    return size;
+}
+
+bool MmapPcapReader::next_record(PcapRecordView& record) {
+    const uint8_t* base = data_;
+    const size_t size = size_;
+
+    while (true) {
+        if (offset_ >= end_) {
+            return false;
+        }
+        if (size - offset_ < sizeof(PcapPacketHeader)) {
+            throw std::runtime_error("Incomplete packet header");
+        }
+
+        PcapPacketHeader pkt_header;
+        std::memcpy(&pkt_header, base + offset_, sizeof(pkt_header));
+        if (is_big_endian_) {
+            pkt_header.ts_sec = swap_bytes32(pkt_header.ts_sec);
+            pkt_header.ts_usec = swap_bytes32(pkt_header.ts_usec);
+            pkt_header.incl_len = swap_bytes32(pkt_header.incl_len);
+            pkt_header.orig_len = swap_bytes32(pkt_header.orig_len);
+        }
+        offset_ += sizeof(pkt_header);
+
+        // 与 PcapReader 一致：跳过空包和超长包
+        if (pkt_header.incl_len == 0 ||
+            pkt_header.incl_len > PCPP_MAX_PACKET_SIZE) {
+            offset_ += std::min<size_t>(pkt_header.incl_len, size - offset_);
+            continue;
+        }
+        if (size - offset_ < pkt_header.incl_len) {
+            throw std::runtime_error("Incomplete packet data");
+        }
+
+        record.data = base + offset_;
+        record.incl_len = pkt_header.incl_len;
+        record.orig_len = pkt_header.orig_len;
+        uint64_t sub_second = has_nano_precision_
+                                  ? pkt_header.ts_usec
+                                  : uint64_t{pkt_header.ts_usec} * 1000;
+        record.timestamp_ns =
+            uint64_t{pkt_header.ts_sec} * 1000000000ULL + sub_second;
+
+        offset_ += pkt_header.incl_len;
+        return true;
+    }
+}
+
+void MmapPcapReader::release_consumed() {
+    // 每积累一定量再归还，避免频繁系统调用
+    constexpr size_t RELEASE_STEP = 64 * 1024 * 1024;
+    if (offset_ >= released_ + RELEASE_STEP) {
+        file_.release_prefix(offset_);
+        released_ = offset_;
+    }
+}
+
+void MmapPcapReader::close() {
+    file_.close();
+    data_ = nullptr;
+    size_ = 0;
+    offset_ = 0;
+    end_ = 0;
+    released_ = 0;
+}
+
+DirectPcapReader::DirectPcapReader(const std::string& filename)
+    : filename_(filename),
+      is_big_endian_(false),
+      has_nano_precision_(false),
+      link_type_(pcpp::LINKTYPE_ETHERNET) {}
+
+bool DirectPcapReader::open() {
+    const char* decompressor =
+        trace_decompressor(detect_trace_format(filename_));
+    bool opened = decompressor != nullptr
+                      ? file_.open_decompressed(filename_, decompressor)
+                      : file_.open(filename_);
+    if (!opened) {
+        return false;
+    }
+    cursor_ = nullptr;
+    available_ = 0;
+    interfaces_.clear();
+
+    // 解压后的内容同样可能是 pcap 或 pcapng，按前 4 个字节区分
+    size_t taken = 0;
+    const uint8_t* data = take(sizeof(uint32_t), taken);
+    if (data == nullptr) {
+        file_.close();
+        return false;
+    }
+    uint32_t magic;
+    std::memcpy(&magic, data, sizeof(magic));
+    pcapng_ = magic == PCAPNG_SECTION_HEADER;
+    if (pcapng_) {
+        data = take(sizeof(uint32_t), taken);
+        uint32_t raw_length = 0;
+        if (data != nullptr) {
+            std::memcpy(&raw_length, data, sizeof(raw_length));
+        }
+        if (data == nullptr || !read_section_header(raw_length)) {
+            file_.close();
+            return false;
+        }
+        return true;
+    }
+
+    PcapFileHeader header;
+    header.magic_number = magic;
+    data = take(sizeof(PcapFileHeader) - sizeof(uint32_t), taken);
+    if (data == nullptr) {
+        file_.close();
+        return false;
+    }
+    std::memcpy(reinterpret_cast<uint8_t*>(&header) + sizeof(uint32_t), data,
+                sizeof(PcapFileHeader) - sizeof(uint32_t));
+    if (!parse_file_header(header, is_big_endian_, has_nano_precision_,
+                           link_type_)) {
+        file_.close();
+        return false;
+    }
+    return true;
+}
+
+uint32_t DirectPcapReader::load32(const uint8_t* p) const {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return is_big_endian_ ? swap_bytes32(value) : value;
+}
+
+bool DirectPcapReader::read_section_header(uint32_t raw_length) {
+    // 块长度的字节序要等读到 byte-order magic 之后才能确定
+    size_t taken = 0;
+    const uint8_t* data = take(sizeof(uint32_t), taken);
+    if (data == nullptr) {
+        return false;
+    }
+    uint32_t byte_order;
+    std::memcpy(&byte_order, data, sizeof(byte_order));
+    if (byte_order == PCAPNG_BYTE_ORDER_MAGIC) {
+        is_big_endian_ = false;
+    } else if (swap_bytes32(byte_order) == PCAPNG_BYTE_ORDER_MAGIC) {
+        is_big_endian_ = true;
+    } else {
+        return false;
+    }
+
+    uint32_t length = is_big_endian_ ? swap_bytes32(raw_length) : raw_length;
+    if (length < 28 || length % 4 != 0) {
+        return false;
+    }
+    // 跳过版本号、section 长度与选项；接口编号在每个 section 内重新开始
+    skip(length - 3 * sizeof(uint32_t));
+    interfaces_.clear();
+    return true;
+}
+
+void DirectPcapReader::add_interface(const uint8_t* body, size_t length) {
+    PcapNgInterface interface;
+    if (length >= 8) {
+        uint16_t link_type;
+        std::memcpy(&link_type, body, sizeof(link_type));
+        if (is_big_endian_) {
+            link_type = swap_bytes16(link_type);
+        }
+        if (pcpp::RawPacket::isLinkTypeValid(link_type)) {
+            interface.link_type = static_cast<pcpp::LinkLayerType>(link_type);
+        }
+    }
+
+    // 选项依次为 code、length 和按 4 字节对齐的值
+    size_t offset = 8;
+    while (offset + 4 <= length) {
+        uint16_t fields[2];
+        std::memcpy(fields, body + offset, sizeof(fields));
+        uint16_t code = is_big_endian_ ? swap_bytes16(fields[0]) : fields[0];
+        uint16_t value_len =
+            is_big_endian_ ? swap_bytes16(fields[1]) : fields[1];
+        offset += 4;
+        if (code == PCAPNG_OPT_END || offset + value_len > length) {
+            break;
+        }
+        if (code == PCAPNG_OPT_IF_TSRESOL && value_len == 1) {
+            interface.ts_resolution = body[offset];
+        } else if (code == PCAPNG_OPT_IF_TSOFFSET && value_len == 8) {
+            uint32_t halves[2] = {load32(body + offset),
+                                  load32(body + offset + 4)};
+            uint64_t value =
+                is_big_endian_
+                    ? (uint64_t{halves[0]} << 32) | halves[1]
+                    : (uint64_t{halves[1]} << 32) | halves[0];
+            interface.ts_offset_sec = static_cast<int64_t>(value);
+        }
+        offset += (value_len + 3u) & ~3u;
+    }
+    interfaces_.push_back(interface);
+}
+
+bool DirectPcapReader::next_pcapng_record(PcapRecordView& record) {
+    while (true) {
+        size_t taken = 0;
+        const uint8_t* head = take(2 * sizeof(uint32_t), taken);
+        if (head == nullptr) {
+            if (taken == 0) {
+                return false;
+            }
+            throw std::runtime_error("Incomplete pcapng block header");
+        }
+        uint32_t type = load32(head);
+        if (type == PCAPNG_SECTION_HEADER) {
+            // 多个 section 首尾相接，块长度的字节序由新 section 决定
+            uint32_t raw_length;
+            std::memcpy(&raw_length, head + sizeof(uint32_t),
+                        sizeof(raw_length));
+            if (!read_section_header(raw_length)) {
+                throw std::runtime_error("Corrupted pcapng section header");
+            }
+            continue;
+        }
+
+        uint32_t length = load32(head + sizeof(uint32_t));
+        if (length < 12 || length % 4 != 0) {
+            throw std::runtime_error("Corrupted pcapng block");
+        }
+        // 块内容含末尾重复的块长度
+        size_t body_len = length - 2 * sizeof(uint32_t);
+        if (type != PCAPNG_INTERFACE_DESCRIPTION &&
+            type != PCAPNG_ENHANCED_PACKET && type != PCAPNG_OBSOLETE_PACKET) {
+            skip(body_len);
+            continue;
+        }
+        if (length > PCAPNG_MAX_BLOCK_LEN) {
+            throw std::runtime_error("Corrupted pcapng block");
+        }
+        const uint8_t* body = take(body_len, taken);
+        if (body == nullptr) {
+            throw std::runtime_error("Incomplete pcapng block");
+        }
+
+        if (type == PCAPNG_INTERFACE_DESCRIPTION) {
+            add_interface(body, body_len);
+            continue;
+        }
+
+        // EPB: interface(4) ts_high ts_low caplen origlen
+        // 旧式 PB: interface(2) drops(2) ts_high ts_low caplen len
+        constexpr size_t PACKET_FIELDS_LEN = 20;
+        if (body_len < PACKET_FIELDS_LEN) {
+            throw std::runtime_error("Corrupted pcapng block");
+        }
+        uint32_t interface_id;
+        if (type == PCAPNG_ENHANCED_PACKET) {
+            interface_id = load32(body);
+        } else {
+            uint16_t id;
+            std::memcpy(&id, body, sizeof(id));
+            interface_id = is_big_endian_ ? swap_bytes16(id) : id;
+        }
+        uint32_t ts_high = load32(body + 4);
+        uint32_t ts_low = load32(body + 8);
+        uint32_t incl_len = load32(body + 12);
+        uint32_t orig_len = load32(body + 16);
+        if (interface_id >= interfaces_.size() ||
+            incl_len > body_len - PACKET_FIELDS_LEN) {
+            throw std::runtime_error("Corrupted pcapng packet block");
+        }
+        // 与 PcapReader 一致：跳过空包和超长包
+        if (incl_len == 0 || incl_len > PCPP_MAX_PACKET_SIZE) {
+            continue;
+        }
+
+        const PcapNgInterface& interface = interfaces_[interface_id];
+        link_type_ = interface.link_type;
+        record.data = body + PACKET_FIELDS_LEN;
+        record.incl_len = incl_len;
+        record.orig_len = orig_len;
+        record.timestamp_ns = pcapng_timestamp_ns(
+            (uint64_t{ts_high} << 32) | ts_low, interface.ts_resolution,
+            interface.ts_offset_sec);
+        return true;
+    }
+}
+
+const uint8_t* DirectPcapReader::take(size_t length, size_t& taken) {
+    if (available_ >= length) {
+        const uint8_t* data = cursor_;
+        cursor_ += length;
+        available_ -= length;
+        taken = length;
+        return data;
+    }
+
+    // 记录跨越块边界，拼接后返回；取下一块会归还当前块，先拷走剩余部分
+    straddle_.assign(cursor_, cursor_ + available_);
+    cursor_ = nullptr;
+    available_ = 0;
+    while (straddle_.size() < length) {
+        const uint8_t* chunk = nullptr;
+        size_t chunk_size = 0;
+        if (!file_.next_chunk(chunk, chunk_size)) {
+            taken = straddle_.size();
+            return nullptr;
+        }
+        size_t needed = std::min(length - straddle_.size(), chunk_size);
+        straddle_.insert(straddle_.end(), chunk, chunk + needed);
+        cursor_ = chunk + needed;
+        available_ = chunk_size - needed;
+    }
+    taken = length;
+    return straddle_.data();
+}
+
+void DirectPcapReader::skip(size_t length) {
+    while (length > 0) {
+        if (available_ == 0) {
+            const uint8_t* chunk = nullptr;
+            size_t chunk_size = 0;
+            if (!file_.next_chunk(chunk, chunk_size)) {
+                return;
+            }
+            cursor_ = chunk;
+            available_ = chunk_size;
+            continue;
+        }
+        size_t step = std::min(length, available_);
+        cursor_ += step;
+        available_ -= step;
+        length -= step;
+    }
+}
+
+bool DirectPcapReader::next_record(PcapRecordView& record) {
+    if (pcapng_) {
+        return next_pcapng_record(record);
+    }
+    while (true) {
+        size_t taken = 0;
+        const uint8_t* header_data = take(sizeof(PcapPacketHeader), taken);
+        if (header_data == nullptr) {
+            if (taken == 0) {
+                return false;
+            }
+            throw std::runtime_error("Incomplete packet header");
+        }
+
+        PcapPacketHeader pkt_header;
+        std::memcpy(&pkt_header, header_data, sizeof(pkt_header));
+        if (is_big_endian_) {
+            pkt_header.ts_sec = swap_bytes32(pkt_header.ts_sec);
+            pkt_header.ts_usec = swap_bytes32(pkt_header.ts_usec);
+            pkt_header.incl_len = swap_bytes32(pkt_header.incl_len);
+            pkt_header.orig_len = swap_bytes32(pkt_header.orig_len);
+        }
+
+        // 与 PcapReader 一致：跳过空包和超长包
+        if (pkt_header.incl_len == 0 ||
+            pkt_header.incl_len > PCPP_MAX_PACKET_SIZE) {
+            skip(pkt_header.incl_len);
+            continue;
+        }
+        const uint8_t* data = take(pkt_header.incl_len, taken);
+        if (data == nullptr) {
+            throw std::runtime_error("Incomplete packet data");
+        }
+
+        record.data = data;
+        record.incl_len = pkt_header.incl_len;
+        record.orig_len = pkt_header.orig_len;
+        uint64_t sub_second = has_nano_precision_
+                                  ? pkt_header.ts_usec
+                                  : uint64_t{pkt_header.ts_usec} * 1000;
+        record.timestamp_ns =
+            uint64_t{pkt_header.ts_sec} * 1000000000ULL + sub_second;
+        return true;
+    }
+}
+
+void DirectPcapReader::close() {
+    file_.close();
+    cursor_ = nullptr;
+    available_ = 0;
+    straddle_.clear();
+}
+
+template <typename Key>
+BasicPacketParser<Key>::BasicPacketParser(PacketParserConfig config)
+    : config_(std::move(config)) {}
+
+template <typename Key>
+typename BasicPacketParser<Key>::PacketVector
+BasicPacketParser<Key>::parse_pcap(const std::string& file_path) const {
     PacketVector packets;
+    size_t descents = 0;
+
+    // pcapng 与压缩 trace 只能顺序读取，统一交给预读读取器
+    PcapReadMode read_mode = config_.read_mode;
+    if (detect_trace_format(file_path) != TraceFormat::Pcap) {
+        read_mode = PcapReadMode::Direct;
+    }
+
+    switch (read_mode) {
+        case PcapReadMode::Stream:
+            parse_stream(file_path, packets, descents);
+            break;
+        case PcapReadMode::Mmap:
+            parse_mmap(file_path, packets, descents);
+            break;
+        case PcapReadMode::Direct:
+            parse_direct(file_path, packets, descents);
+            break;
+    }
+
+    // 按时间戳排序，输入已有序时直接跳过
+    sort_by_timestamp(packets, descents);
+
+    return packets;
+}
 
+template <typename Key>
+void BasicPacketParser<Key>::parse_stream(const std::string& file_path,
+                                          PacketVector& packets,
+                                          size_t& descents) const {
     PcapReader reader(file_path);
     if (!reader.open()) {
         throw std::runtime_error("Failed to open pcap file: " + file_path);
@@ -197,31 +1209,236 @@ PacketParser::PacketVector PacketParser::parse_pcap(
 
     pcpp::RawPacket raw_packet;
     while (reader.get_next_packet(raw_packet)) {
-        pcpp::Packet parsed_packet(&raw_packet, pcpp::OsiModelNetworkLayer);
-
-        auto* ipv4_layer = parsed_packet.getLayerOfType<pcpp::IPv4Layer>();
-        if (!ipv4_layer) {
+        Record record;
+        if (!extract_flow(raw_packet, record.flow)) {
             continue;
         }
 
-        PacketRecord record;
-        record.flow.src_ip = ipv4_layer->getSrcIPv4Address().toInt();
-        record.flow.dst_ip = ipv4_layer->getDstIPv4Address().toInt();
-
         const timespec& ts = raw_packet.getPacketTimeStamp();
         record.timestamp = std::chrono::seconds{ts.tv_sec} +
                            std::chrono::nanoseconds{ts.tv_nsec};
+        if (!config_.in_time_window(record.timestamp.count())) {
+            continue;
+        }
 
+        if (!packets.empty() && record.timestamp < packets.back().timestamp) {
+            descents += 1;
+        }
         packets.push_back(record);
     }
 
     reader.close();
+}
 
-    // 按时间戳排序
-    std::sort(packets.begin(), packets.end(),
-              [](const PacketRecord& a, const PacketRecord& b) {
-                  return a.timestamp < b.timestamp;
-              });
+namespace {
 
-    return packets;
+// 按读取范围占文件的比例估计包数
+size_t estimate_range_packet_count(const std::string& file_path,
+                                   size_t range_bytes,
+                                   size_t file_size) {
+    double share = static_cast<double>(range_bytes) /
+                   static_cast<double>(std::max<size_t>(1, file_size));
+    return static_cast<size_t>(
+        static_cast<double>(estimate_packet_count(file_path)) * share);
 }
+
+}  // namespace
+
+template <typename Key>
+void BasicPacketParser<Key>::parse_mmap(const std::string& file_path,
+                                        PacketVector& packets,
+                                        size_t& descents) const {
+    MmapPcapReader reader(file_path);
+    if (!reader.open()) {
+        throw std::runtime_error("Failed to open pcap file: " + file_path);
+    }
+
+    // 有时间范围时借助索引只读取相关的字节区间
+    size_t range_begin = 0;
+    size_t range_end = reader.file_size();
+    TraceIndex index;
+    if (config_.has_time_window() && index.load_or_build(file_path)) {
+        index.byte_range(config_.begin_ts, config_.end_ts, range_begin,
+                         range_end);
+    }
+    size_t range_bytes = range_end - std::min(range_end, range_begin);
+
+    size_t threads = config_.parse_threads;
+    if (threads == 0) {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    // 分块过小时线程开销大于收益
+    constexpr size_t MIN_CHUNK_BYTES = 4 * 1024 * 1024;
+    threads = std::min(threads,
+                       std::max<size_t>(1, range_bytes / MIN_CHUNK_BYTES));
+
+    if (threads > 1 &&
+        parse_mmap_parallel(file_path, reader, range_begin, range_end, threads,
+                            packets, descents)) {
+        return;
+    }
+
+    packets.clear();
+    packets.reserve(estimate_range_packet_count(file_path, range_bytes,
+                                                reader.file_size()));
+    descents = 0;
+    reader.set_range(range_begin, range_end);
+    decode_records(reader, packets, descents);
+    reader.close();
+}
+
+template <typename Key>
+bool BasicPacketParser<Key>::parse_mmap_parallel(
+    const std::string& file_path,
+    const MmapPcapReader& reader,
+    size_t range_begin,
+    size_t range_end,
+    size_t threads,
+    PacketVector& packets,
+    size_t& descents) const {
+    // 按字节均分读取范围，并把每个切分点对齐到下一个记录边界
+    const size_t range_bytes = range_end - range_begin;
+    std::vector<size_t> boundaries(threads + 1);
+    boundaries[0] = range_begin;
+    boundaries[threads] = range_end;
+    for (size_t i = 1; i < threads; ++i) {
+        size_t boundary = reader.find_record_boundary(
+            range_begin + range_bytes / threads * i);
+        boundaries[i] =
+            std::min(std::max(boundary, boundaries[i - 1]), range_end);
+    }
+
+    std::vector<PacketVector> partial(threads);
+    std::vector<size_t> stop_offsets(threads, 0);
+    std::vector<size_t> partial_descents(threads, 0);
+    const size_t reserve_per_thread =
+        estimate_range_packet_count(file_path, range_bytes,
+                                    reader.file_size()) /
+            threads +
+        1;
+
+    // 各线程通过视图共享同一个映射，只读取自己的分块
+    try {
+        run_in_parallel(threads, [&](size_t i) {
+            MmapPcapReader chunk_reader =
+                reader.view(boundaries[i], boundaries[i + 1]);
+            partial[i].reserve(reserve_per_thread);
+            decode_records(chunk_reader, partial[i], partial_descents[i]);
+            stop_offsets[i] = chunk_reader.offset();
+        });
+    } catch (const std::runtime_error&) {
+        // 边界误判会把载荷当作记录头，串行路径重新读取并报告真正的错误
+        return false;
+    }
+
+    // 每个分块必须恰好停在下一个分块的起点，否则说明边界误判，改走串行路径
+    for (size_t i = 0; i < threads; ++i) {
+        if (stop_offsets[i] != boundaries[i + 1]) {
+            return false;
+        }
+    }
+
+    size_t total = 0;
+    for (const auto& part : partial) {
+        total += part.size();
+    }
+    packets.clear();
+    packets.reserve(total);
+    descents = 0;
+    for (size_t i = 0; i < threads; ++i) {
+        auto& part = partial[i];
+        // 分块拼接处同样可能出现逆序
+        if (!packets.empty() && !part.empty() &&
+            part.front().timestamp < packets.back().timestamp) {
+            descents += 1;
+        }
+        descents += partial_descents[i];
+        packets.insert(packets.end(), part.begin(), part.end());
+        PacketVector().swap(part);
+    }
+    return true;
+}
+
+template <typename Key>
+void BasicPacketParser<Key>::parse_direct(const std::string& file_path,
+                                          PacketVector& packets,
+                                          size_t& descents) const {
+    DirectPcapReader reader(file_path);
+    if (!reader.open()) {
+        throw std::runtime_error("Failed to open pcap file: " + file_path);
+    }
+
+    packets.reserve(estimate_packet_count(file_path));
+    decode_records(reader, packets, descents);
+    reader.close();
+}
+
+template <typename Key>
+template <typename Reader>
+void BasicPacketParser<Key>::decode_records(Reader& reader,
+                                            PacketVector& packets,
+                                            size_t& descents) const {
+    PcapRecordView view;
+    Record record;
+    while (reader.next_record(view)) {
+        if (!decode_record(view, reader.link_type(), record)) {
+            continue;
+        }
+        if (!packets.empty() && record.timestamp < packets.back().timestamp) {
+            descents += 1;
+        }
+        packets.push_back(record);
+    }
+}
+
+template <typename Key>
+bool BasicPacketParser<Key>::decode_record(const PcapRecordView& view,
+                                           pcpp::LinkLayerType link_type,
+                                           Record& record) const {
+    if (!config_.in_time_window(view.timestamp_ns)) {
+        return false;
+    }
+    record.timestamp = std::chrono::nanoseconds{view.timestamp_ns};
+    if (config_.fast_decode) {
+        DecodeStatus status =
+            decode_flow(view.data, view.incl_len, link_type, record.flow);
+        if (status != DecodeStatus::Unsupported) {
+            return status == DecodeStatus::Ok;
+        }
+    }
+
+    // RawPacket 只借用映射内存，不负责释放
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(view.timestamp_ns / 1000000000ULL);
+    ts.tv_nsec = static_cast<long>(view.timestamp_ns % 1000000000ULL);
+    pcpp::RawPacket raw_packet(view.data, static_cast<int>(view.incl_len), ts,
+                               false, link_type);
+    return pcpp_extract_flow(raw_packet, record.flow);
+}
+
+template <typename Key>
+bool BasicPacketParser<Key>::extract_flow(pcpp::RawPacket& raw_packet,
+                                          Key& flow) const {
+    if (config_.fast_decode) {
+        DecodeStatus status = decode_flow(
+            raw_packet.getRawData(),
+            static_cast<size_t>(raw_packet.getRawDataLen()),
+            raw_packet.getLinkLayerType(), flow);
+        if (status != DecodeStatus::Unsupported) {
+            return status == DecodeStatus::Ok;
+        }
+    }
+    return pcpp_extract_flow(raw_packet, flow);
+}
+
+template class BasicPacketParser<TwoTuple>;
+template class BasicPacketParser<FiveTuple>;
+template class BasicPacketParser<IPv6TwoTuple>;
+
+template void sort_by_timestamp(std::vector<BasicPacketRecord<TwoTuple>>&,
+                                size_t);
+template void sort_by_timestamp(std::vector<BasicPacketRecord<FiveTuple>>&,
+                                size_t);
+template void sort_by_timestamp(
+    std::vector<BasicPacketRecord<IPv6TwoTuple>>&,
+    size_t);
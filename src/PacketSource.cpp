@@ -0,0 +1,460 @@
+#include "PacketSource.h"
+
+#include "TraceIndex.h"
+
+namespace {
+
+// 归并时每个来源每次拉取的包数
+constexpr size_t kMergeBatchSize = 4096;
+
+}  // namespace
+
+template <typename Key>
+BasicVectorPacketSource<Key>::BasicVectorPacketSource(
+    const std::vector<Record>& packets)
+    : packets_(packets) {}
+
+template <typename Key>
+size_t BasicVectorPacketSource<Key>::next_batch(const Record*& batch,
+                                                size_t max_count) {
+    size_t count = std::min(max_count, packets_.size() - position_);
+    batch = packets_.data() + position_;
+    position_ += count;
+    return count;
+}
+
+template <typename Key>
+bool BasicVectorPacketSource<Key>::time_bounds(uint64_t& first_ts,
+                                               uint64_t& last_ts) const {
+    if (packets_.empty()) {
+        return false;
+    }
+    first_ts = packets_.front().timestamp.count();
+    last_ts = packets_.back().timestamp.count();
+    return true;
+}
+
+PcapPacketSource::PcapPacketSource(const std::string& file_path,
+                                   PacketParserConfig config)
+    : parser_(config) {
+    bool opened;
+    if (config.read_mode == PcapReadMode::Direct ||
+        detect_trace_format(file_path) != TraceFormat::Pcap) {
+        direct_reader_.reset(new DirectPcapReader(file_path));
+        opened = direct_reader_->open();
+    } else {
+        mmap_reader_.reset(new MmapPcapReader(file_path));
+        opened = mmap_reader_->open();
+    }
+    if (!opened) {
+        throw std::runtime_error("Failed to open pcap file: " + file_path);
+    }
+
+    // 有时间范围时借助索引跳过范围之前的数据
+    TraceIndex index;
+    if (mmap_reader_ && config.has_time_window() &&
+        index.load_or_build(file_path)) {
+        size_t begin = 0;
+        size_t end = 0;
+        index.byte_range(config.begin_ts, config.end_ts, begin, end);
+        mmap_reader_->set_range(begin, end);
+    }
+}
+
+bool PcapPacketSource::start_time(uint64_t& start_ts) const {
+    if (!parser_.config().has_begin_ts) {
+        return false;
+    }
+    start_ts = parser_.config().begin_ts;
+    return true;
+}
+
+template <typename Reader>
+void PcapPacketSource::fill_window(Reader& reader, size_t window) {
+    PcapRecordView view;
+    Pending pending;
+    while (!reader_done_ && reorder_.size() < window) {
+        if (!reader.next_record(view)) {
+            reader_done_ = true;
+            reader.close();
+            break;
+        }
+        if (parser_.decode_record(view, reader.link_type(), pending.record)) {
+            pending.sequence = next_sequence_++;
+            reorder_.push(pending);
+        }
+    }
+}
+
+size_t PcapPacketSource::next_batch(const PacketRecord*& batch,
+                                    size_t max_count) {
+    buffer_.clear();
+    const size_t window = std::max<size_t>(1, parser_.config().reorder_window);
+
+    while (buffer_.size() < max_count) {
+        // 先把乱序窗口填满，再输出最早的包
+        if (mmap_reader_) {
+            fill_window(*mmap_reader_, window);
+        } else {
+            fill_window(*direct_reader_, window);
+        }
+        if (reorder_.empty()) {
+            break;
+        }
+        buffer_.push_back(reorder_.top().record);
+        reorder_.pop();
+    }
+
+    if (!reader_done_ && mmap_reader_) {
+        mmap_reader_->release_consumed();
+    }
+    batch = buffer_.data();
+    return buffer_.size();
+}
+
+GeneratorPacketSource::GeneratorPacketSource(Generator generator)
+    : generator_(std::move(generator)) {}
+
+size_t GeneratorPacketSource::next_batch(const PacketRecord*& batch,
+                                         size_t max_count) {
+    buffer_.clear();
+    PacketRecord record;
+    while (!finished_ && buffer_.size() < max_count) {
+        if (!generator_(record)) {
+            finished_ = true;
+            break;
+        }
+        buffer_.push_back(record);
+    }
+    batch = buffer_.data();
+    return buffer_.size();
+}
+
+template <typename Key>
+BasicMergedPacketSource<Key>::BasicMergedPacketSource(
+    std::vector<std::unique_ptr<BasicPacketSource<Key>>> sources)
+    : sources_(std::move(sources)), cursors_(sources_.size()) {}
+
+template <typename Key>
+bool BasicMergedPacketSource<Key>::advance(size_t source) {
+    Cursor& cursor = cursors_[source];
+    cursor.position += 1;
+    if (cursor.position < cursor.size) {
+        return true;
+    }
+    // 当前批已用完，各来源的批只在下一次拉取前有效
+    cursor.size = sources_[source]->next_batch(cursor.batch, kMergeBatchSize);
+    cursor.position = 0;
+    return cursor.size > 0;
+}
+
+template <typename Key>
+size_t BasicMergedPacketSource<Key>::next_batch(const Record*& batch,
+                                                size_t max_count) {
+    // 只有一个来源时直接转发，不做拷贝
+    if (sources_.size() == 1) {
+        return sources_[0]->next_batch(batch, max_count);
+    }
+
+    if (!started_) {
+        started_ = true;
+        for (size_t i = 0; i < sources_.size(); ++i) {
+            Cursor& cursor = cursors_[i];
+            cursor.size =
+                sources_[i]->next_batch(cursor.batch, kMergeBatchSize);
+            cursor.position = 0;
+            if (cursor.size > 0) {
+                heads_.push(
+                    {static_cast<uint64_t>(cursor.batch[0].timestamp.count()),
+                     i});
+            }
+        }
+    }
+
+    buffer_.clear();
+    while (buffer_.size() < max_count && !heads_.empty()) {
+        size_t source = heads_.top().source;
+        heads_.pop();
+        const Cursor& cursor = cursors_[source];
+        buffer_.push_back(cursor.batch[cursor.position]);
+        if (advance(source)) {
+            heads_.push(
+                {static_cast<uint64_t>(
+                     cursor.batch[cursor.position].timestamp.count()),
+                 source});
+        }
+    }
+    batch = buffer_.data();
+    return buffer_.size();
+}
+
+template <typename Key>
+bool BasicMergedPacketSource<Key>::time_bounds(uint64_t& first_ts,
+                                               uint64_t& last_ts) const {
+    bool any = false;
+    for (const auto& source : sources_) {
+        uint64_t first = 0;
+        uint64_t last = 0;
+        if (!source->time_bounds(first, last)) {
+            return false;
+        }
+        first_ts = any ? std::min(first_ts, first) : first;
+        last_ts = any ? std::max(last_ts, last) : last;
+        any = true;
+    }
+    return any;
+}
+
+template <typename Key>
+bool BasicMergedPacketSource<Key>::start_time(uint64_t& start_ts) const {
+    bool any = false;
+    for (const auto& source : sources_) {
+        uint64_t start = 0;
+        if (!source->start_time(start)) {
+            return false;
+        }
+        start_ts = any ? std::min(start_ts, start) : start;
+        any = true;
+    }
+    return any;
+}
+
+std::unique_ptr<PacketSource> make_pcap_source(
+    const std::vector<std::string>& paths,
+    const PacketParserConfig& config) {
+    if (paths.size() == 1) {
+        return std::unique_ptr<PacketSource>(
+            new PcapPacketSource(paths[0], config));
+    }
+    std::vector<std::unique_ptr<PacketSource>> sources;
+    sources.reserve(paths.size());
+    for (const auto& path : paths) {
+        sources.emplace_back(new PcapPacketSource(path, config));
+    }
+    return std::unique_ptr<PacketSource>(
+        new MergedPacketSource(std::move(sources)));
+}
+
+template <typename Key>
+typename BasicPacketParser<Key>::PacketVector parse_pcap_files(
+    const std::vector<std::string>& paths,
+    const BasicPacketParser<Key>& parser) {
+    using PacketVector = typename BasicPacketParser<Key>::PacketVector;
+    if (paths.size() == 1) {
+        return parser.parse_pcap(paths[0]);
+    }
+
+    std::vector<PacketVector> parts;
+    parts.reserve(paths.size());
+    size_t total = 0;
+    for (const auto& path : paths) {
+        parts.push_back(parser.parse_pcap(path));
+        total += parts.back().size();
+    }
+
+    std::vector<std::unique_ptr<BasicPacketSource<Key>>> sources;
+    sources.reserve(parts.size());
+    for (const auto& part : parts) {
+        sources.emplace_back(new BasicVectorPacketSource<Key>(part));
+    }
+    BasicMergedPacketSource<Key> merged(std::move(sources));
+
+    PacketVector packets;
+    packets.reserve(total);
+    const BasicPacketRecord<Key>* batch = nullptr;
+    size_t count = 0;
+    while ((count = merged.next_batch(batch, kMergeBatchSize)) > 0) {
+        packets.insert(packets.end(), batch, batch + count);
+    }
+    return packets;
+}
+
+template class BasicVectorPacketSource<TwoTuple>;
+template class BasicVectorPacketSource<FiveTuple>;
+template class BasicVectorPacketSource<IPv6TwoTuple>;
+
+template class BasicMergedPacketSource<TwoTuple>;
+template class BasicMergedPacketSource<FiveTuple>;
+template class BasicMergedPacketSource<IPv6TwoTuple>;
+
+template PacketParser::PacketVector parse_pcap_files(
+    const std::vector<std::string>&,
+    const BasicPacketParser<TwoTuple>&);
+template BasicPacketParser<FiveTuple>::PacketVector parse_pcap_files(
+    const std::vector<std::string>&,
+    const BasicPacketParser<FiveTuple>&);
+template BasicPacketParser<IPv6TwoTuple>::PacketVector parse_pcap_files(
+    const std::vector<std::string>&,
+    const BasicPacketParser<IPv6TwoTuple>&);
+
+PipelinedPacketSource::PipelinedPacketSource(std::unique_ptr<PacketSource> inner,
+                                             size_t depth,
+                                             size_t batch_size)
+    : inner_(std::move(inner)),
+      batch_size_(std::max<size_t>(1, batch_size)),
+      ring_(depth) {
+    producer_ = std::thread(&PipelinedPacketSource::produce, this);
+}
+
+PipelinedPacketSource::~PipelinedPacketSource() {
+    stop_.store(true, std::memory_order_relaxed);
+    ring_.wake();
+    if (producer_.joinable()) {
+        producer_.join();
+    }
+}
+
+void PipelinedPacketSource::produce() {
+    try {
+        const PacketRecord* batch = nullptr;
+        size_t count = 0;
+        while (!stop_.load(std::memory_order_relaxed) &&
+               (count = inner_->next_batch(batch, batch_size_)) > 0) {
+            // 等待空闲槽位，消费者停止时退出
+            std::vector<PacketRecord>* slot = ring_.wait_acquire([this]() {
+                return stop_.load(std::memory_order_relaxed);
+            });
+            if (slot == nullptr) {
+                return;
+            }
+            slot->assign(batch, batch + count);
+            ring_.publish();
+        }
+    } catch (...) {
+        error_ = std::current_exception();
+    }
+    producer_done_.store(true, std::memory_order_release);
+    ring_.wake();
+}
+
+size_t PipelinedPacketSource::next_batch(const PacketRecord*& batch,
+                                         size_t max_count) {
+    if (current_ != nullptr && position_ >= current_->size()) {
+        ring_.release();
+        current_ = nullptr;
+    }
+    if (current_ == nullptr) {
+        current_ = ring_.wait_front([this]() {
+            return producer_done_.load(std::memory_order_acquire);
+        });
+        if (current_ == nullptr) {
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+            return 0;
+        }
+        position_ = 0;
+    }
+
+    size_t count = std::min(max_count, current_->size() - position_);
+    batch = current_->data() + position_;
+    position_ += count;
+    return count;
+}
+
+bool PipelinedPacketSource::time_bounds(uint64_t& first_ts,
+                                        uint64_t& last_ts) const {
+    return inner_->time_bounds(first_ts, last_ts);
+}
+
+bool PipelinedPacketSource::start_time(uint64_t& start_ts) const {
+    return inner_->start_time(start_ts);
+}
+
+PacedPacketSource::PacedPacketSource(std::unique_ptr<PacketSource> inner,
+                                     double speedup)
+    : inner_(std::move(inner)), speedup_(speedup > 0.0 ? speedup : 1.0) {}
+
+PacedPacketSource::Clock::time_point PacedPacketSource::due(
+    uint64_t ts) const {
+    // 乱序窗口之外的迟到包按第一个包的时刻处理
+    uint64_t elapsed = ts > first_ts_ ? ts - first_ts_ : 0;
+    double offset = static_cast<double>(elapsed) / speedup_;
+    return wall_start_ +
+           std::chrono::nanoseconds(static_cast<int64_t>(offset));
+}
+
+size_t PacedPacketSource::next_batch(const PacketRecord*& batch,
+                                     size_t max_count) {
+    if (pending_count_ == 0) {
+        pending_count_ = inner_->next_batch(pending_, max_count);
+        if (pending_count_ == 0) {
+            return 0;
+        }
+    }
+    if (!started_) {
+        started_ = true;
+        wall_start_ = Clock::now();
+        first_ts_ = pending_[0].timestamp.count();
+    }
+
+    // 等待第一个包到期，较长的等待让出 CPU，最后一段自旋
+    Clock::time_point first_due = due(pending_[0].timestamp.count());
+    Clock::time_point now = Clock::now();
+    if (now < first_due) {
+        Clock::time_point wait_start = now;
+        while (first_due - now > std::chrono::microseconds(200)) {
+            std::this_thread::sleep_for(first_due - now -
+                                        std::chrono::microseconds(100));
+            now = Clock::now();
+        }
+        while (now < first_due) {
+            now = Clock::now();
+        }
+        idle_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        now - wait_start)
+                        .count();
+    }
+
+    // 交付所有已到期的包，至少一个
+    size_t limit = std::min(max_count, pending_count_);
+    size_t count = 1;
+    while (count < limit && due(pending_[count].timestamp.count()) <= now) {
+        ++count;
+    }
+
+    uint64_t lag = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       now - first_due)
+                       .count();
+    max_lag_ns_ = std::max(max_lag_ns_, lag);
+    lag_sum_ += static_cast<double>(lag) * count;
+
+    batch = pending_;
+    pending_ += count;
+    pending_count_ -= count;
+    packets_ += count;
+    last_ts_ = batch[count - 1].timestamp.count();
+    return count;
+}
+
+bool PacedPacketSource::time_bounds(uint64_t& first_ts,
+                                    uint64_t& last_ts) const {
+    return inner_->time_bounds(first_ts, last_ts);
+}
+
+bool PacedPacketSource::start_time(uint64_t& start_ts) const {
+    return inner_->start_time(start_ts);
+}
+
+ReplayStats PacedPacketSource::stats() const {
+    ReplayStats result;
+    if (!started_) {
+        return result;
+    }
+    Clock::time_point now = Clock::now();
+    Clock::time_point last_due = due(last_ts_);
+    result.packets = packets_;
+    result.trace_span_ns = last_ts_ > first_ts_ ? last_ts_ - first_ts_ : 0;
+    result.elapsed_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - wall_start_)
+            .count();
+    result.idle_ns = idle_ns_;
+    result.max_lag_ns = max_lag_ns_;
+    result.mean_lag_ns = packets_ > 0 ? lag_sum_ / packets_ : 0.0;
+    result.final_lag_ns =
+        now > last_due ? std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             now - last_due)
+                             .count()
+                       : 0;
+    return result;
+}
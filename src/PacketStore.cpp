@@ -0,0 +1,130 @@
+#include "PacketStore.h"
+
+namespace {
+
+// from_source 每次拉取的包数
+constexpr size_t kSourceBatchSize = 4096;
+
+}  // namespace
+
+template <typename Key>
+BasicPacketStore<Key>::BasicPacketStore(const Record* records,
+                                        size_t count,
+                                        uint64_t epoch_duration_ns,
+                                        uint64_t origin_ts) {
+    append(records, count);
+    finish_interning();
+    build_epoch_index(epoch_duration_ns, origin_ts);
+}
+
+template <typename Key>
+BasicPacketStore<Key>::BasicPacketStore(const std::vector<Record>& packets,
+                                        uint64_t epoch_duration_ns,
+                                        uint64_t origin_ts)
+    : BasicPacketStore(packets.data(),
+                       packets.size(),
+                       epoch_duration_ns,
+                       origin_ts) {}
+
+template <typename Key>
+BasicPacketStore<Key> BasicPacketStore<Key>::from_source(
+    BasicPacketSource<Key>& source,
+    uint64_t epoch_duration_ns) {
+    BasicPacketStore store;
+    const Record* batch = nullptr;
+    size_t count = 0;
+    while ((count = source.next_batch(batch, kSourceBatchSize)) > 0) {
+        store.append(batch, count);
+    }
+    store.finish_interning();
+    uint64_t origin_ts = 0;
+    source.start_time(origin_ts);
+    store.build_epoch_index(epoch_duration_ns, origin_ts);
+    return store;
+}
+
+template <typename Key>
+void BasicPacketStore<Key>::append(const Record* records, size_t count) {
+    timestamps_.reserve(timestamps_.size() + count);
+    flow_ids_.reserve(flow_ids_.size() + count);
+    for (size_t i = 0; i < count; ++i) {
+        timestamps_.push_back(records[i].timestamp.count());
+        auto it = interner_
+                      .emplace(records[i].flow,
+                               static_cast<uint32_t>(dictionary_.size()))
+                      .first;
+        if (it->second == dictionary_.size()) {
+            dictionary_.push_back(records[i].flow);
+        }
+        flow_ids_.push_back(it->second);
+    }
+}
+
+template <typename Key>
+void BasicPacketStore<Key>::finish_interning() {
+    decltype(interner_)().swap(interner_);
+    dictionary_.shrink_to_fit();
+}
+
+template <typename Key>
+void BasicPacketStore<Key>::build_epoch_index(uint64_t epoch_duration_ns,
+                                              uint64_t origin_ts) {
+    epoch_duration_ = std::max<uint64_t>(1, epoch_duration_ns);
+    epoch_offsets_.clear();
+    if (timestamps_.empty()) {
+        first_ts_ = 0;
+        return;
+    }
+
+    first_ts_ = origin_ts > 0 && origin_ts <= timestamps_.front()
+                    ? origin_ts
+                    : timestamps_.front();
+    uint64_t epochs = (timestamps_.back() - first_ts_) / epoch_duration_ + 1;
+    epoch_offsets_.reserve(epochs + 1);
+    epoch_offsets_.push_back(0);
+
+    // 单次线性扫描即可得到所有 epoch 边界
+    size_t index = 0;
+    for (uint64_t epoch = 1; epoch < epochs; ++epoch) {
+        uint64_t boundary = epoch_start(epoch);
+        while (index < timestamps_.size() && timestamps_[index] < boundary) {
+            ++index;
+        }
+        epoch_offsets_.push_back(index);
+    }
+    epoch_offsets_.push_back(timestamps_.size());
+}
+
+template <typename Key>
+size_t BasicPacketStore<Key>::lower_bound(uint64_t ts,
+                                          size_t begin,
+                                          size_t end) const {
+    return static_cast<size_t>(
+        std::lower_bound(timestamps_.begin() + begin,
+                         timestamps_.begin() + end, ts) -
+        timestamps_.begin());
+}
+
+template <typename Key>
+void BasicPacketStore<Key>::subepoch_offsets(
+    size_t epoch,
+    uint32_t subepoch_count,
+    uint64_t subepoch_duration,
+    std::vector<size_t>& offsets) const {
+    size_t begin = epoch_begin(epoch);
+    size_t end = epoch_end(epoch);
+    uint64_t start = epoch_start(epoch);
+
+    offsets.clear();
+    offsets.push_back(begin);
+    size_t cursor = begin;
+    for (uint32_t k = 1; k < subepoch_count; ++k) {
+        cursor = lower_bound(start + k * subepoch_duration, cursor, end);
+        offsets.push_back(cursor);
+    }
+    offsets.push_back(end);
+}
+
+template class BasicPacketStore<TwoTuple>;
+template class BasicPacketStore<FiveTuple>;
+template class BasicPacketStore<IPv6TwoTuple>;
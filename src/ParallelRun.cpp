@@ -0,0 +1,82 @@
+#include "ParallelRun.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+ParallelRunner::ParallelRunner(size_t threads) {
+    for (size_t j = 1; j < std::max<size_t>(1, threads); ++j) {
+        workers_.emplace_back(new Worker());
+    }
+    for (size_t j = 0; j < workers_.size(); ++j) {
+        workers_[j]->thread = std::thread(&ParallelRunner::work, this, j + 1);
+    }
+}
+
+ParallelRunner::~ParallelRunner() {
+    stop_.store(true, std::memory_order_relaxed);
+    for (auto& worker : workers_) {
+        worker->wake.notify();
+    }
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+void ParallelRunner::dispatch(size_t count,
+                              const std::function<void(size_t)>& task) {
+    if (count > threads()) {
+        throw std::invalid_argument("ParallelRunner: too many jobs");
+    }
+    task_ = &task;
+    pending_.store(count > 0 ? count - 1 : 0, std::memory_order_relaxed);
+    for (size_t j = 1; j < count; ++j) {
+        Worker& worker = *workers_[j - 1];
+        worker.error = nullptr;
+        worker.ready.store(true, std::memory_order_release);
+        worker.wake.notify();
+    }
+
+    std::exception_ptr error;
+    try {
+        if (count > 0) {
+            task(0);
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+    done_.wait(
+        [this]() { return pending_.load(std::memory_order_acquire) == 0; });
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    for (size_t j = 1; j < count; ++j) {
+        if (workers_[j - 1]->error) {
+            std::rethrow_exception(workers_[j - 1]->error);
+        }
+    }
+}
+
+void ParallelRunner::work(size_t index) {
+    Worker& worker = *workers_[index - 1];
+    while (true) {
+        worker.wake.wait([&worker, this]() {
+            return worker.ready.load(std::memory_order_acquire) ||
+                   stop_.load(std::memory_order_relaxed);
+        });
+        if (!worker.ready.load(std::memory_order_acquire)) {
+            return;
+        }
+        worker.ready.store(false, std::memory_order_relaxed);
+        try {
+            (*task_)(index);
+        } catch (...) {
+            worker.error = std::current_exception();
+        }
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            done_.notify();
+        }
+    }
+}
@@ -0,0 +1,250 @@
+#include "ReadAheadFile.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+extern char** environ;
+
+namespace {
+
+// O_DIRECT 要求偏移、长度和缓冲区地址按块设备扇区对齐，取 4KB 覆盖常见设备
+constexpr size_t kDirectAlignment = 4096;
+
+}  // namespace
+
+void ReadAheadFile::AlignedFree::operator()(uint8_t* p) const {
+    std::free(p);
+}
+
+ReadAheadFile::ReadAheadFile(size_t chunk_bytes, size_t depth)
+    : chunk_bytes_((std::max(chunk_bytes, kDirectAlignment) +
+                    kDirectAlignment - 1) /
+                   kDirectAlignment * kDirectAlignment),
+      ring_(depth) {}
+
+ReadAheadFile::~ReadAheadFile() {
+    close();
+}
+
+bool ReadAheadFile::open(const std::string& path) {
+    close();
+
+    fd_ = ::open(path.c_str(), O_RDONLY | O_DIRECT);
+    direct_.store(fd_ >= 0, std::memory_order_relaxed);
+    if (fd_ < 0) {
+        // tmpfs 等文件系统不支持 O_DIRECT
+        fd_ = ::open(path.c_str(), O_RDONLY);
+    }
+    if (fd_ < 0) {
+        return false;
+    }
+    if (!direct()) {
+        ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    file_size_ = static_cast<size_t>(st.st_size);
+
+    start();
+    return true;
+}
+
+bool ReadAheadFile::open_decompressed(const std::string& path,
+                                      const std::string& program) {
+    close();
+
+    int pipe_fds[2];
+    if (::pipe2(pipe_fds, O_CLOEXEC) != 0) {
+        return false;
+    }
+
+    // 子进程的标准输出接到管道写端，dup2 会清除 O_CLOEXEC
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDOUT_FILENO);
+
+    std::string decompress_flag = "-dc";
+    std::string end_of_options = "--";
+    std::string program_name = program;
+    std::string file_path = path;
+    char* argv[] = {&program_name[0], &decompress_flag[0], &end_of_options[0],
+                    &file_path[0], nullptr};
+    pid_t pid = -1;
+    int rc = ::posix_spawnp(&pid, program.c_str(), &actions, nullptr, argv,
+                            environ);
+    posix_spawn_file_actions_destroy(&actions);
+    ::close(pipe_fds[1]);
+    if (rc != 0) {
+        ::close(pipe_fds[0]);
+        return false;
+    }
+
+    fd_ = pipe_fds[0];
+    child_ = pid;
+    program_ = program;
+    direct_.store(false, std::memory_order_relaxed);
+    file_size_ = 0;
+
+    start();
+    return true;
+}
+
+void ReadAheadFile::start() {
+    stop_.store(false, std::memory_order_relaxed);
+    reader_done_.store(false, std::memory_order_relaxed);
+    read_error_.clear();
+    holding_ = false;
+    reader_ = std::thread(&ReadAheadFile::read_ahead, this);
+}
+
+void ReadAheadFile::read_ahead() {
+    size_t offset = 0;
+    while (!stop_.load(std::memory_order_relaxed)) {
+        Chunk* chunk = ring_.wait_acquire(
+            [this]() { return stop_.load(std::memory_order_relaxed); });
+        if (chunk == nullptr) {
+            break;
+        }
+        if (!chunk->buffer) {
+            void* p = nullptr;
+            if (::posix_memalign(&p, kDirectAlignment, chunk_bytes_) != 0) {
+                read_error_ = std::strerror(ENOMEM);
+                break;
+            }
+            chunk->buffer.reset(static_cast<uint8_t*>(p));
+        }
+
+        // 读满一整块，只有到达文件末尾时才会不足；管道不支持 pread
+        size_t filled = 0;
+        while (filled < chunk_bytes_) {
+            ssize_t n =
+                child_ > 0
+                    ? ::read(fd_, chunk->buffer.get() + filled,
+                             chunk_bytes_ - filled)
+                    : ::pread(fd_, chunk->buffer.get() + filled,
+                              chunk_bytes_ - filled,
+                              static_cast<off_t>(offset + filled));
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EINVAL && direct()) {
+                    // 部分文件系统在读取时才拒绝 O_DIRECT，改为普通读取
+                    int flags = ::fcntl(fd_, F_GETFL);
+                    ::fcntl(fd_, F_SETFL, flags & ~O_DIRECT);
+                    direct_.store(false, std::memory_order_relaxed);
+                    continue;
+                }
+                read_error_ = std::strerror(errno);
+                break;
+            }
+            if (n == 0) {
+                break;
+            }
+            filled += static_cast<size_t>(n);
+        }
+        if (filled < chunk_bytes_ && read_error_.empty() && child_ > 0) {
+            check_child();
+        }
+        if (!read_error_.empty()) {
+            break;
+        }
+
+        chunk->size = filled;
+        ring_.publish();
+        offset += filled;
+        if (filled < chunk_bytes_) {
+            break;
+        }
+    }
+    reader_done_.store(true, std::memory_order_release);
+    ring_.wake();
+}
+
+void ReadAheadFile::check_child() {
+    // 只查看退出状态不回收进程，close() 中的 kill 才不会误伤复用的 pid
+    siginfo_t info;
+    std::memset(&info, 0, sizeof(info));
+    if (::waitid(P_PID, static_cast<id_t>(child_), &info,
+                 WEXITED | WNOWAIT) != 0) {
+        read_error_ = std::strerror(errno);
+        return;
+    }
+    if (info.si_code != CLD_EXITED) {
+        read_error_ = program_ + " terminated by signal " +
+                      std::to_string(info.si_status);
+    } else if (info.si_status == 127) {
+        read_error_ = program_ + " could not be executed";
+    } else if (info.si_status != 0) {
+        read_error_ = program_ + " exited with status " +
+                      std::to_string(info.si_status);
+    }
+}
+
+bool ReadAheadFile::next_chunk(const uint8_t*& data, size_t& size) {
+    if (fd_ < 0) {
+        return false;
+    }
+    if (holding_) {
+        ring_.release();
+        holding_ = false;
+    }
+
+    Chunk* chunk = ring_.wait_front([this]() {
+        return reader_done_.load(std::memory_order_acquire);
+    });
+    if (chunk == nullptr) {
+        if (!read_error_.empty()) {
+            throw std::runtime_error("Read-ahead failed: " + read_error_);
+        }
+        return false;
+    }
+
+    holding_ = true;
+    data = chunk->buffer.get();
+    size = chunk->size;
+    return true;
+}
+
+void ReadAheadFile::close() {
+    stop_.store(true, std::memory_order_relaxed);
+    ring_.wake();
+    if (child_ > 0) {
+        // 提前结束时让解压程序退出，阻塞在管道读取上的预读线程随之返回
+        ::kill(child_, SIGTERM);
+    }
+    if (reader_.joinable()) {
+        reader_.join();
+    }
+    // 丢弃尚未取用的块
+    while (ring_.try_front() != nullptr) {
+        ring_.release();
+    }
+    holding_ = false;
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    if (child_ > 0) {
+        int status = 0;
+        while (::waitpid(child_, &status, 0) < 0 && errno == EINTR) {
+        }
+        child_ = -1;
+    }
+    fd_ = -1;
+    file_size_ = 0;
+}
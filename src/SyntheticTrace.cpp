@@ -0,0 +1,137 @@
+#include "SyntheticTrace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// log1p(x) / x，x 接近 0 时用泰勒展开
+double log1p_over_x(double x) {
+    if (std::fabs(x) > 1e-8) {
+        return std::log1p(x) / x;
+    }
+    return 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
+
+// expm1(x) / x，x 接近 0 时用泰勒展开
+double expm1_over_x(double x) {
+    if (std::fabs(x) > 1e-8) {
+        return std::expm1(x) / x;
+    }
+    return 1.0 + x * 0.5 * (1.0 + x / 3.0 * (1.0 + 0.25 * x));
+}
+
+// splitmix64，状态每次加固定增量，输出经过混合
+inline uint64_t splitmix64(uint64_t& state) {
+    state += 0x9e3779b97f4a7c15ULL;
+    uint64_t z = state;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+}  // namespace
+
+ZipfSampler::ZipfSampler(uint64_t n, double alpha)
+    : n_(static_cast<double>(n)), alpha_(alpha) {
+    if (n == 0) {
+        throw std::invalid_argument("ZipfSampler needs at least one element");
+    }
+    if (alpha <= 0.0) {
+        throw std::invalid_argument("ZipfSampler needs a positive exponent");
+    }
+    h_integral_x1_ = h_integral(1.5) - 1.0;
+    h_integral_n_ = h_integral(n_ + 0.5);
+    s_ = 2.0 - h_integral_inverse(h_integral(2.5) - h(2.0));
+}
+
+double ZipfSampler::h(double x) const {
+    return std::exp(-alpha_ * std::log(x));
+}
+
+// h 的原函数：(x^(1-alpha) - 1) / (1 - alpha)，alpha = 1 时为 log(x)
+double ZipfSampler::h_integral(double x) const {
+    double log_x = std::log(x);
+    return expm1_over_x((1.0 - alpha_) * log_x) * log_x;
+}
+
+double ZipfSampler::h_integral_inverse(double x) const {
+    double t = x * (1.0 - alpha_);
+    if (t < -1.0) {
+        // 浮点误差可能使 t 略小于 -1
+        t = -1.0;
+    }
+    return std::exp(log1p_over_x(t) * x);
+}
+
+SyntheticPacketSource::SyntheticPacketSource(
+    const SyntheticTraceConfig& config)
+    : config_(config),
+      zipf_(std::max<uint64_t>(1, config.flows), config.zipf_alpha),
+      rng_state_(config.seed),
+      interval_ns_(config.rate_pps > 0.0 ? 1e9 / config.rate_pps : 0.0),
+      clock_ns_(0.0) {}
+
+double SyntheticPacketSource::next_uniform() {
+    // 取高 53 位作为双精度尾数
+    constexpr double kScale = 1.0 / 9007199254740992.0;  // 2^-53
+    return static_cast<double>(splitmix64(rng_state_) >> 11) * kScale;
+}
+
+TwoTuple SyntheticPacketSource::flow_of(uint64_t rank) const {
+    // mix_flow_bits 是 64 位上的双射，不同排名一定得到不同的二元组
+    uint64_t bits = mix_flow_bits(rank ^ (config_.seed << 32));
+    return TwoTuple(static_cast<uint32_t>(bits >> 32),
+                    static_cast<uint32_t>(bits));
+}
+
+size_t SyntheticPacketSource::next_batch(const PacketRecord*& batch,
+                                         size_t max_count) {
+    size_t count = static_cast<size_t>(
+        std::min<uint64_t>(max_count, config_.packets - generated_));
+    buffer_.resize(count);
+    auto uniform = [this]() { return next_uniform(); };
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t offset;
+        if (config_.poisson) {
+            offset = static_cast<uint64_t>(clock_ns_);
+            clock_ns_ -= std::log1p(-next_uniform()) * interval_ns_;
+        } else {
+            offset = static_cast<uint64_t>(
+                static_cast<double>(generated_ + i) * interval_ns_);
+        }
+        PacketRecord& record = buffer_[i];
+        record.flow = flow_of(zipf_.sample(uniform));
+        record.timestamp = std::chrono::nanoseconds(config_.start_ns + offset);
+    }
+    generated_ += count;
+    batch = buffer_.data();
+    return count;
+}
+
+bool SyntheticPacketSource::time_bounds(uint64_t& first_ts,
+                                        uint64_t& last_ts) const {
+    // 泊松到达的结束时间事先未知
+    if (config_.poisson || config_.packets == 0) {
+        return false;
+    }
+    first_ts = config_.start_ns;
+    last_ts = config_.start_ns +
+              static_cast<uint64_t>(
+                  static_cast<double>(config_.packets - 1) * interval_ns_);
+    return true;
+}
+
+PacketParser::PacketVector generate_synthetic_trace(
+    const SyntheticTraceConfig& config) {
+    SyntheticPacketSource source(config);
+    PacketParser::PacketVector packets;
+    packets.reserve(static_cast<size_t>(config.packets));
+    const PacketRecord* batch = nullptr;
+    size_t count = 0;
+    while ((count = source.next_batch(batch, 65536)) > 0) {
+        packets.insert(packets.end(), batch, batch + count);
+    }
+    return packets;
+}
@@ -0,0 +1,191 @@
+#include "TraceCache.h"
+
+#include <sys/stat.h>
+
+#include <cstdio>
+
+namespace {
+
+const char kCacheMagic[8] = {'D', 'S', 'K', 'T', 'R', 'A', 'C', 'E'};
+const uint32_t kCacheVersion = 1;
+const size_t kHashSampleBytes = 64 * 1024;
+
+uint64_t fnv1a(const uint8_t* data, size_t length, uint64_t hash) {
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// 把源文件指纹写入缓存文件头
+bool describe_source(const std::string& source_path, TraceCacheHeader& header) {
+    SourceFingerprint fingerprint;
+    if (!fingerprint_source(source_path, fingerprint)) {
+        return false;
+    }
+    header.source_size = fingerprint.size;
+    header.source_mtime_ns = fingerprint.mtime_ns;
+    header.source_hash = fingerprint.hash;
+    return true;
+}
+
+}  // namespace
+
+bool fingerprint_source(const std::string& source_path,
+                        SourceFingerprint& fingerprint) {
+    struct stat st;
+    if (::stat(source_path.c_str(), &st) != 0) {
+        return false;
+    }
+    fingerprint.size = static_cast<uint64_t>(st.st_size);
+    fingerprint.mtime_ns =
+        static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL +
+        st.st_mtim.tv_nsec;
+
+    MappedFile source;
+    if (!source.open(source_path)) {
+        return false;
+    }
+    size_t head = std::min(kHashSampleBytes, source.size());
+    size_t tail = std::min(kHashSampleBytes, source.size() - head);
+    uint64_t hash = fnv1a(source.data(), head, 14695981039346656037ULL);
+    hash = fnv1a(source.data() + source.size() - tail, tail, hash);
+    fingerprint.hash = hash;
+    return true;
+}
+
+std::string TraceCache::default_path(const std::string& source_path) {
+    return source_path + ".cache";
+}
+
+bool TraceCache::open(const std::string& cache_path,
+                      const std::string& source_path) {
+    close();
+
+    TraceCacheHeader expected;
+    if (!describe_source(source_path, expected)) {
+        return false;
+    }
+    if (!file_.open(cache_path) || file_.size() < sizeof(TraceCacheHeader)) {
+        file_.close();
+        return false;
+    }
+
+    TraceCacheHeader header;
+    std::memcpy(&header, file_.data(), sizeof(header));
+    bool valid =
+        std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) == 0 &&
+        header.version == kCacheVersion &&
+        header.record_size == sizeof(PacketRecord) &&
+        header.source_size == expected.source_size &&
+        header.source_mtime_ns == expected.source_mtime_ns &&
+        header.source_hash == expected.source_hash &&
+        file_.size() == sizeof(TraceCacheHeader) +
+                            header.packet_count * sizeof(PacketRecord);
+    if (!valid) {
+        file_.close();
+        return false;
+    }
+
+    records_ = reinterpret_cast<const PacketRecord*>(file_.data() +
+                                                     sizeof(TraceCacheHeader));
+    count_ = static_cast<size_t>(header.packet_count);
+    first_ts_ = header.first_ts;
+    last_ts_ = header.last_ts;
+    return true;
+}
+
+bool TraceCache::write(const std::string& cache_path,
+                       const std::string& source_path,
+                       const PacketParser::PacketVector& packets) {
+    TraceCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    if (!describe_source(source_path, header)) {
+        return false;
+    }
+    std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+    header.version = kCacheVersion;
+    header.record_size = sizeof(PacketRecord);
+    header.packet_count = packets.size();
+    if (!packets.empty()) {
+        header.first_ts = packets.front().timestamp.count();
+        header.last_ts = packets.back().timestamp.count();
+    }
+
+    // 写入临时文件后再 rename，中途失败不会留下半个缓存
+    std::string temp_path = cache_path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(packets.data()),
+                  packets.size() * sizeof(PacketRecord));
+        if (!out) {
+            out.close();
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temp_path.c_str(), cache_path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+PacketParser::PacketVector TraceCache::load_or_parse(
+    const std::string& source_path,
+    const std::string& cache_path,
+    const PacketParser& parser,
+    bool* hit) {
+    TraceCache cache;
+    if (cache.open(cache_path, source_path)) {
+        if (hit != nullptr) {
+            *hit = true;
+        }
+        return cache.to_vector();
+    }
+
+    if (hit != nullptr) {
+        *hit = false;
+    }
+    PacketParser::PacketVector packets = parser.parse_pcap(source_path);
+    write(cache_path, source_path, packets);
+    return packets;
+}
+
+void TraceCache::close() {
+    file_.close();
+    records_ = nullptr;
+    count_ = 0;
+    first_ts_ = 0;
+    last_ts_ = 0;
+}
+
+PacketParser::PacketVector TraceCache::to_vector() const {
+    return PacketParser::PacketVector(records_, records_ + count_);
+}
+
+CachedPacketSource::CachedPacketSource(const TraceCache& cache)
+    : cache_(cache) {}
+
+size_t CachedPacketSource::next_batch(const PacketRecord*& batch,
+                                      size_t max_count) {
+    size_t count = std::min(max_count, cache_.size() - position_);
+    batch = cache_.data() + position_;
+    position_ += count;
+    return count;
+}
+
+bool CachedPacketSource::time_bounds(uint64_t& first_ts,
+                                     uint64_t& last_ts) const {
+    if (cache_.size() == 0) {
+        return false;
+    }
+    first_ts = cache_.first_ts();
+    last_ts = cache_.last_ts();
+    return true;
+}
@@ -0,0 +1,203 @@
+#include "TraceIndex.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+namespace {
+
+const char kIndexMagic[8] = {'D', 'S', 'K', 'I', 'N', 'D', 'E', 'X'};
+const uint32_t kIndexVersion = 1;
+
+}  // namespace
+
+std::string TraceIndex::default_path(const std::string& source_path) {
+    return source_path + ".idx";
+}
+
+bool TraceIndex::open(const std::string& index_path,
+                      const std::string& source_path) {
+    checkpoints_.clear();
+
+    SourceFingerprint expected;
+    if (!fingerprint_source(source_path, expected)) {
+        return false;
+    }
+    std::ifstream in(index_path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    TraceIndexHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        return false;
+    }
+    bool valid =
+        std::memcmp(header.magic, kIndexMagic, sizeof(kIndexMagic)) == 0 &&
+        header.version == kIndexVersion &&
+        header.source_size == expected.size &&
+        header.source_mtime_ns == expected.mtime_ns &&
+        header.source_hash == expected.hash && header.checkpoint_count > 0;
+    if (!valid) {
+        return false;
+    }
+
+    std::vector<TraceIndexCheckpoint> checkpoints(
+        static_cast<size_t>(header.checkpoint_count));
+    if (!in.read(reinterpret_cast<char*>(checkpoints.data()),
+                 checkpoints.size() * sizeof(TraceIndexCheckpoint))) {
+        return false;
+    }
+    checkpoints_.swap(checkpoints);
+    first_ts_ = header.first_ts;
+    last_ts_ = header.last_ts;
+    return true;
+}
+
+bool TraceIndex::build(const std::string& source_path,
+                       const std::string& index_path,
+                       uint32_t record_interval) {
+    if (detect_trace_format(source_path) != TraceFormat::Pcap) {
+        return false;
+    }
+    TraceIndexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    SourceFingerprint fingerprint;
+    if (!fingerprint_source(source_path, fingerprint)) {
+        return false;
+    }
+    MmapPcapReader reader(source_path);
+    if (!reader.open()) {
+        return false;
+    }
+    record_interval = std::max<uint32_t>(1, record_interval);
+
+    // 只读记录头，不解码报文
+    const uint64_t kNoRecord = std::numeric_limits<uint64_t>::max();
+    std::vector<TraceIndexCheckpoint> checkpoints;
+    std::vector<uint64_t> segment_min;  // 每段内记录的最小时间戳
+    uint64_t prefix_max = 0;
+    uint64_t first_ts = kNoRecord;
+    uint64_t records = 0;
+    PcapRecordView view;
+    while (true) {
+        size_t offset = reader.offset();
+        if (!reader.next_record(view)) {
+            break;
+        }
+        if (records % record_interval == 0) {
+            checkpoints.push_back({offset, prefix_max, 0});
+            segment_min.push_back(kNoRecord);
+        }
+        segment_min.back() = std::min(segment_min.back(), view.timestamp_ns);
+        prefix_max = std::max(prefix_max, view.timestamp_ns);
+        first_ts = std::min(first_ts, view.timestamp_ns);
+        records += 1;
+    }
+    // 末尾检查点指向最后一条完整记录之后
+    checkpoints.push_back({reader.offset(), prefix_max, kNoRecord});
+    reader.close();
+
+    // 从后向前累积每个检查点之后的最小时间戳
+    for (size_t i = segment_min.size(); i-- > 0;) {
+        checkpoints[i].suffix_min_ts =
+            std::min(segment_min[i], checkpoints[i + 1].suffix_min_ts);
+    }
+
+    std::memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+    header.version = kIndexVersion;
+    header.record_interval = record_interval;
+    header.checkpoint_count = checkpoints.size();
+    header.first_ts = records > 0 ? first_ts : 0;
+    header.last_ts = prefix_max;
+    header.source_size = fingerprint.size;
+    header.source_mtime_ns = fingerprint.mtime_ns;
+    header.source_hash = fingerprint.hash;
+
+    // 写入临时文件后再 rename，中途失败不会留下半个索引
+    std::string temp_path = index_path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(checkpoints.data()),
+                  checkpoints.size() * sizeof(TraceIndexCheckpoint));
+        if (!out) {
+            out.close();
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temp_path.c_str(), index_path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool TraceIndex::load_or_build(const std::string& source_path) {
+    std::string index_path = default_path(source_path);
+    if (open(index_path, source_path)) {
+        return true;
+    }
+    return build(source_path, index_path) && open(index_path, source_path);
+}
+
+void TraceIndex::byte_range(uint64_t begin_ts,
+                            uint64_t end_ts,
+                            size_t& begin,
+                            size_t& end) const {
+    // prefix_max_ts 与 suffix_min_ts 都随偏移单调不减，可以二分查找
+    // 起点：最后一个之前的记录全部早于 begin_ts 的检查点
+    auto first_late = std::partition_point(
+        checkpoints_.begin(), checkpoints_.end(),
+        [begin_ts](const TraceIndexCheckpoint& checkpoint) {
+            return checkpoint.prefix_max_ts < begin_ts;
+        });
+    begin = first_late == checkpoints_.begin()
+                ? checkpoints_.front().offset
+                : std::prev(first_late)->offset;
+
+    // 终点：第一个之后的记录全部不早于 end_ts 的检查点
+    end = checkpoints_.back().offset;
+    if (end_ts > 0) {
+        auto first_after = std::partition_point(
+            checkpoints_.begin(), checkpoints_.end(),
+            [end_ts](const TraceIndexCheckpoint& checkpoint) {
+                return checkpoint.suffix_min_ts < end_ts;
+            });
+        end = first_after->offset;
+    }
+    end = std::max(begin, end);
+}
+
+bool trace_start_time(const std::vector<std::string>& paths,
+                      uint64_t& first_ts) {
+    bool any = false;
+    for (const auto& path : paths) {
+        uint64_t ts = 0;
+        bool found = false;
+        TraceIndex index;
+        if (index.load_or_build(path)) {
+            found = index.checkpoint_count() > 1;
+            ts = index.first_ts();
+        } else {
+            // 只能顺序读取的格式以第一条记录为准
+            DirectPcapReader reader(path);
+            PcapRecordView view;
+            if (reader.open() && reader.next_record(view)) {
+                found = true;
+                ts = view.timestamp_ns;
+            }
+            reader.close();
+        }
+        if (found) {
+            first_ts = any ? std::min(first_ts, ts) : ts;
+            any = true;
+        }
+    }
+    return any;
+}
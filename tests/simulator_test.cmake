@@ -0,0 +1,92 @@
+# 仿真程序的回归测试，用 cmake -P 运行
+#
+# 必需参数：
+#   SIMULATOR  disketch_simulator 的路径
+#   CONFIG     基础配置文件
+#   WORK_DIR   生成配置与输出的目录
+#   NAME       本次测试名，用于区分生成的文件
+# 可选参数，多个键值用 | 分隔：
+#   INPUT      pcap 路径，两次运行都写入 [global]
+#   COMMON     两次运行都追加到 [global] 的键值
+#   GLOBAL     只追加到被测运行 [global] 的键值
+#   FRAGMENT   追加到每个 [fragment:*] 的键值
+#   EXPECT     stderr 中必须出现的正则，多个用 | 分隔；
+#              未给出时与不追加键值的串行结果逐字节比较
+#   EXPECT_FAIL 为真时要求仿真程序以非零状态退出
+
+foreach(var SIMULATOR CONFIG WORK_DIR NAME)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "缺少参数 ${var}")
+    endif()
+endforeach()
+
+if(DEFINED INPUT)
+    set(COMMON "pcap=${INPUT}|${COMMON}")
+endif()
+
+file(MAKE_DIRECTORY "${WORK_DIR}")
+file(READ "${CONFIG}" base)
+
+# 把 GLOBAL 与 FRAGMENT 的键值写入配置，返回生成的文件路径
+function(write_config out_var suffix global fragment)
+    set(text "${base}")
+    if(global)
+        string(REPLACE "|" "\n" lines "${global}")
+        string(REPLACE "[global]\n" "[global]\n${lines}\n" text "${text}")
+    endif()
+    if(fragment)
+        string(REPLACE "|" "\n" lines "${fragment}")
+        string(REGEX REPLACE "(\\[fragment:[^]\n]*\\]\n)" "\\1${lines}\n"
+               text "${text}")
+    endif()
+    set(path "${WORK_DIR}/${NAME}${suffix}.ini")
+    file(WRITE "${path}" "${text}")
+    set(${out_var} "${path}" PARENT_SCOPE)
+endfunction()
+
+# 运行仿真程序，返回退出状态、结果行与 stderr
+function(run_simulator config result_var out_var err_var)
+    execute_process(
+        COMMAND "${SIMULATOR}" -c "${config}" -q
+        RESULT_VARIABLE result
+        OUTPUT_VARIABLE out
+        ERROR_VARIABLE err)
+    set(${result_var} "${result}" PARENT_SCOPE)
+    set(${out_var} "${out}" PARENT_SCOPE)
+    set(${err_var} "${err}" PARENT_SCOPE)
+endfunction()
+
+write_config(config "" "${COMMON}|${GLOBAL}" "${FRAGMENT}")
+run_simulator("${config}" result out err)
+
+if(DEFINED EXPECT)
+    if(EXPECT_FAIL AND result EQUAL 0)
+        message(FATAL_ERROR "应当失败却成功退出\n${err}")
+    endif()
+    if(NOT EXPECT_FAIL AND NOT result EQUAL 0)
+        message(FATAL_ERROR "退出状态 ${result}\n${err}")
+    endif()
+    string(REPLACE "|" ";" patterns "${EXPECT}")
+    foreach(pattern IN LISTS patterns)
+        if(NOT err MATCHES "${pattern}")
+            message(FATAL_ERROR "stderr 中没有 \"${pattern}\"\n${err}")
+        endif()
+    endforeach()
+    return()
+endif()
+
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "退出状态 ${result}\n${err}")
+endif()
+write_config(serial_config "_serial" "${COMMON}" "")
+run_simulator("${serial_config}" serial_result serial_out serial_err)
+if(NOT serial_result EQUAL 0)
+    message(FATAL_ERROR "串行运行退出状态 ${serial_result}\n${serial_err}")
+endif()
+if(out STREQUAL "")
+    message(FATAL_ERROR "没有输出结果行\n${err}")
+endif()
+if(NOT out STREQUAL serial_out)
+    message(FATAL_ERROR
+            "与串行结果不一致\n串行:\n${serial_out}\n本次:\n${out}")
+endif()